@@ -6,17 +6,55 @@
 
 #include <algorithm>
 #include <bitset>
+#include <chrono>
 #include <fstream>
+#include <list>
 #include <limits>
 #include <vector>
 #include <array>
 #include <string>
-#include <stack>
-#include <sstream>
-#include <iomanip>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
 #include <cstdlib>
-#include <regex>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+#if !defined(TDB_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define TDB_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TDB_POSIX 1
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// loadAll() reads files in batches through io_uring, Linux only
+#ifdef TDB_IO_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 
 namespace tdb {
@@ -67,12 +105,19 @@ namespace detail {
             }
         }
     };
-    static const ParseError_category theParseError_category{};
+
+    // one object for the whole program, error codes from different
+    // translation units compare by its address
+    inline const std::error_category &parseErrorCategory() noexcept
+    {
+        static const ParseError_category category{};
+        return category;
+    }
 }  // namespace detail
 
-std::error_code make_error_code(ParseError e) noexcept
+inline std::error_code make_error_code(ParseError e) noexcept
 {
-    return { static_cast<int>(e), detail::theParseError_category };
+    return { static_cast<int>(e), detail::parseErrorCategory() };
 }
 
 enum class bin {
@@ -581,251 +626,4763 @@ enum class str {
     box_chars_1
 };
 
+namespace detail {
+    // a capability's terminfo name ("smcup") and its long name
+    // ("enter_ca_mode"), the latter being also the enumerator's name
+    struct CapName {
+        const char *shortName;
+        const char *longName;
+    };
 
-class TermDb {
-private:
-    std::bitset<numCapBool> booleans{};
-    std::array<uint16_t, numCapNum> numbers{};
-    std::string name;
-    std::vector<uint16_t> stringOffset;
-    std::vector<char> stringTable;
-    bool isValidState = false;
-
-    // https://regex101.com/r/GwGLfk/1
-    static constexpr auto delayStr = R"(\$<\d+(\.\d{1})?((\/?\*?)|(\*?\/?))>)";
-
-    std::error_code loadDB(const std::string, std::string);
-    void escape(std::string &) const;
-    std::string parser(const std::string &, param, param, param, param, param,
-                       param, param, param, param) const;
+    // FNV-1a, with the high half folded down since lookups use the low bits
+    constexpr uint32_t fnv1a(const char *s, std::size_t n, uint32_t h)
+    {
+        return n == 0 ? h
+                      : fnv1a(s + 1, n - 1,
+                              (h ^ static_cast<unsigned char>(*s)) * 16777619u);
+    }
+    constexpr uint32_t fold(uint32_t h) { return h ^ (h >> 16); }
+    constexpr uint32_t nameHash(const char *s, std::size_t n, uint32_t seed)
+    {
+        return fold(fnv1a(s, n, 2166136261u ^ seed));
+    }
 
-public:
-    TermDb() = default;
-    TermDb(const std::string &_name, std::string _path = DPATH)
+    constexpr std::size_t nameLength(const char *s)
     {
-        const auto error = loadDB(_name, _path);
-        if (error) {
-            throw error;
-        } else {
-            isValidState = true;
-        }
+        return *s == '\0' ? 0 : 1 + nameLength(s + 1);
+    }
+    constexpr bool sameName(const char *name, const char *s, std::size_t n)
+    {
+        return n == 0 ? *name == '\0'
+                      : *name == *s && sameName(name + 1, s + 1, n - 1);
     }
+}  // namespace detail
 
-    explicit operator bool() const noexcept { return isValidState; }
-    std::string getName() const { return name; }
+// BEGIN capability names (generated by scripts/capnames.py)
+namespace detail {
+    constexpr CapName binNames[] = {
+        {"bw", "auto_left_margin"},
+        {"am", "auto_right_margin"},
+        {"xsb", "no_esc_ctlc"},
+        {"xhp", "ceol_standout_glitch"},
+        {"xenl", "eat_newline_glitch"},
+        {"eo", "erase_overstrike"},
+        {"gn", "generic_type"},
+        {"hc", "hard_copy"},
+        {"km", "has_meta_key"},
+        {"hs", "has_status_line"},
+        {"in", "insert_null_glitch"},
+        {"da", "memory_above"},
+        {"db", "memory_below"},
+        {"mir", "move_insert_mode"},
+        {"msgr", "move_standout_mode"},
+        {"os", "over_strike"},
+        {"eslok", "status_line_esc_ok"},
+        {"xt", "dest_tabs_magic_smso"},
+        {"hz", "tilde_glitch"},
+        {"ul", "transparent_underline"},
+        {"xon", "xon_xoff"},
+        {"nxon", "needs_xon_xoff"},
+        {"mc5i", "prtr_silent"},
+        {"chts", "hard_cursor"},
+        {"nrrmc", "non_rev_rmcup"},
+        {"npc", "no_pad_char"},
+        {"ndscr", "non_dest_scroll_region"},
+        {"ccc", "can_change"},
+        {"bce", "back_color_erase"},
+        {"hls", "hue_lightness_saturation"},
+        {"xhpa", "col_addr_glitch"},
+        {"crxm", "cr_cancels_micro_mode"},
+        {"daisy", "has_print_wheel"},
+        {"xvpa", "row_addr_glitch"},
+        {"sam", "semi_auto_right_margin"},
+        {"cpix", "cpi_changes_res"},
+        {"lpix", "lpi_changes_res"},
+        {"OTbs", "backspaces_with_bs"},
+        {"OTns", "crt_no_scrolling"},
+        {"OTnc", "no_correctly_working_cr"},
+        {"OTMT", "gnu_has_meta_key"},
+        {"OTNL", "linefeed_is_newline"},
+        {"OTpt", "has_hardware_tabs"},
+        {"OTxr", "return_does_clr_eol"}
+    };
+    constexpr uint16_t binDisp[] = {
+        1, 9, 5, 3, 4, 20, 2, 1, 4, 1, 17, 15, 2, 1, 4, 5, 8, 1, 8, 1, 1, 5
+    };
+    constexpr uint16_t binSlots[] = {
+        0, 37, 8, 0, 15, 0, 23, 0, 16, 8, 12, 0, 24, 44, 43, 0, 21, 40, 17, 44,
+        24, 28, 0, 0, 20, 39, 28, 0, 34, 17, 0, 0, 12, 32, 19, 10, 7, 36, 9, 5,
+        0, 3, 35, 25, 0, 0, 23, 9, 41, 2, 21, 22, 36, 16, 29, 0, 20, 0, 3, 34,
+        0, 0, 26, 14, 43, 30, 0, 1, 0, 0, 0, 1, 42, 25, 0, 0, 13, 42, 33, 14,
+        39, 0, 31, 0, 33, 22, 0, 4, 0, 10, 0, 0, 0, 7, 2, 18, 40, 18, 0, 13, 0,
+        0, 4, 35, 38, 6, 0, 19, 0, 26, 0, 27, 11, 11, 15, 6, 37, 41, 30, 32, 0,
+        5, 29, 0, 31, 0, 27, 38
+    };
 
-    bool parse(const std::string _name, std::string _path = DPATH)
+    constexpr CapName numNames[] = {
+        {"cols", "columns"},
+        {"it", "init_tabs"},
+        {"lines", "lines"},
+        {"lm", "lines_of_memory"},
+        {"xmc", "magic_cookie_glitch"},
+        {"pb", "padding_baud_rate"},
+        {"vt", "virtual_terminal"},
+        {"wsl", "width_status_line"},
+        {"nlab", "num_labels"},
+        {"lh", "label_height"},
+        {"lw", "label_width"},
+        {"ma", "max_attributes"},
+        {"wnum", "maximum_windows"},
+        {"colors", "max_colors"},
+        {"pairs", "max_pairs"},
+        {"ncv", "no_color_video"},
+        {"bufsz", "buffer_capacity"},
+        {"spinv", "dot_vert_spacing"},
+        {"spinh", "dot_horz_spacing"},
+        {"maddr", "max_micro_address"},
+        {"mjump", "max_micro_jump"},
+        {"mcs", "micro_col_size"},
+        {"mls", "micro_line_size"},
+        {"npins", "number_of_pins"},
+        {"orc", "output_res_char"},
+        {"orl", "output_res_line"},
+        {"orhi", "output_res_horz_inch"},
+        {"orvi", "output_res_vert_inch"},
+        {"cps", "print_rate"},
+        {"widcs", "wide_char_size"},
+        {"btns", "buttons"},
+        {"bitwin", "bit_image_entwining"},
+        {"bitype", "bit_image_type"},
+        {"OTug", "magic_cookie_glitch_ul"},
+        {"OTdC", "carriage_return_delay"},
+        {"OTdN", "new_line_delay"},
+        {"OTdB", "backspace_delay"},
+        {"OTdT", "horizontal_tab_delay"},
+        {"OTkn", "number_of_function_keys"}
+    };
+    constexpr uint16_t numDisp[] = {
+        2, 3, 3, 3, 5, 12, 2, 1, 1, 3, 1, 5, 2, 2, 7, 6, 17, 7, 27
+    };
+    constexpr uint16_t numSlots[] = {
+        39, 19, 38, 5, 0, 36, 0, 0, 0, 20, 37, 0, 0, 36, 35, 29, 7, 0, 32, 18,
+        0, 35, 10, 0, 0, 25, 0, 22, 0, 24, 33, 38, 14, 37, 10, 2, 4, 30, 0, 33,
+        25, 0, 31, 0, 27, 0, 0, 0, 26, 0, 0, 11, 26, 6, 0, 0, 0, 19, 0, 34, 23,
+        4, 3, 2, 9, 31, 17, 11, 0, 0, 0, 16, 0, 0, 22, 0, 0, 0, 8, 17, 15, 0,
+        14, 23, 8, 18, 28, 12, 5, 34, 13, 0, 1, 29, 9, 0, 0, 24, 20, 30, 13, 0,
+        0, 0, 0, 1, 0, 0, 0, 0, 0, 12, 0, 7, 0, 32, 21, 6, 21, 16, 0, 0, 39,
+        28, 0, 27, 0, 15
+    };
+
+    constexpr CapName strNames[] = {
+        {"cbt", "back_tab"},
+        {"bel", "bell"},
+        {"cr", "carriage_return"},
+        {"csr", "change_scroll_region"},
+        {"tbc", "clear_all_tabs"},
+        {"clear", "clear_screen"},
+        {"el", "clr_eol"},
+        {"ed", "clr_eos"},
+        {"hpa", "column_address"},
+        {"cmdch", "command_character"},
+        {"cup", "cursor_address"},
+        {"cud1", "cursor_down"},
+        {"home", "cursor_home"},
+        {"civis", "cursor_invisible"},
+        {"cub1", "cursor_left"},
+        {"mrcup", "cursor_mem_address"},
+        {"cnorm", "cursor_normal"},
+        {"cuf1", "cursor_right"},
+        {"ll", "cursor_to_ll"},
+        {"cuu1", "cursor_up"},
+        {"cvvis", "cursor_visible"},
+        {"dch1", "delete_character"},
+        {"dl1", "delete_line"},
+        {"dsl", "dis_status_line"},
+        {"hd", "down_half_line"},
+        {"smacs", "enter_alt_charset_mode"},
+        {"blink", "enter_blink_mode"},
+        {"bold", "enter_bold_mode"},
+        {"smcup", "enter_ca_mode"},
+        {"smdc", "enter_delete_mode"},
+        {"dim", "enter_dim_mode"},
+        {"smir", "enter_insert_mode"},
+        {"invis", "enter_secure_mode"},
+        {"prot", "enter_protected_mode"},
+        {"rev", "enter_reverse_mode"},
+        {"smso", "enter_standout_mode"},
+        {"smul", "enter_underline_mode"},
+        {"ech", "erase_chars"},
+        {"rmacs", "exit_alt_charset_mode"},
+        {"sgr0", "exit_attribute_mode"},
+        {"rmcup", "exit_ca_mode"},
+        {"rmdc", "exit_delete_mode"},
+        {"rmir", "exit_insert_mode"},
+        {"rmso", "exit_standout_mode"},
+        {"rmul", "exit_underline_mode"},
+        {"flash", "flash_screen"},
+        {"ff", "form_feed"},
+        {"fsl", "from_status_line"},
+        {"is1", "init_1string"},
+        {"is2", "init_2string"},
+        {"is3", "init_3string"},
+        {"if", "init_file"},
+        {"ich1", "insert_character"},
+        {"il1", "insert_line"},
+        {"ip", "insert_padding"},
+        {"kbs", "key_backspace"},
+        {"ktbc", "key_catab"},
+        {"kclr", "key_clear"},
+        {"kctab", "key_ctab"},
+        {"kdch1", "key_dc"},
+        {"kdl1", "key_dl"},
+        {"kcud1", "key_down"},
+        {"krmir", "key_eic"},
+        {"kel", "key_eol"},
+        {"ked", "key_eos"},
+        {"kf0", "key_f0"},
+        {"kf1", "key_f1"},
+        {"kf10", "key_f10"},
+        {"kf2", "key_f2"},
+        {"kf3", "key_f3"},
+        {"kf4", "key_f4"},
+        {"kf5", "key_f5"},
+        {"kf6", "key_f6"},
+        {"kf7", "key_f7"},
+        {"kf8", "key_f8"},
+        {"kf9", "key_f9"},
+        {"khome", "key_home"},
+        {"kich1", "key_ic"},
+        {"kil1", "key_il"},
+        {"kcub1", "key_left"},
+        {"kll", "key_ll"},
+        {"knp", "key_npage"},
+        {"kpp", "key_ppage"},
+        {"kcuf1", "key_right"},
+        {"kind", "key_sf"},
+        {"kri", "key_sr"},
+        {"khts", "key_stab"},
+        {"kcuu1", "key_up"},
+        {"rmkx", "keypad_local"},
+        {"smkx", "keypad_xmit"},
+        {"lf0", "lab_f0"},
+        {"lf1", "lab_f1"},
+        {"lf10", "lab_f10"},
+        {"lf2", "lab_f2"},
+        {"lf3", "lab_f3"},
+        {"lf4", "lab_f4"},
+        {"lf5", "lab_f5"},
+        {"lf6", "lab_f6"},
+        {"lf7", "lab_f7"},
+        {"lf8", "lab_f8"},
+        {"lf9", "lab_f9"},
+        {"rmm", "meta_off"},
+        {"smm", "meta_on"},
+        {"nel", "newline"},
+        {"pad", "pad_char"},
+        {"dch", "parm_dch"},
+        {"dl", "parm_delete_line"},
+        {"cud", "parm_down_cursor"},
+        {"ich", "parm_ich"},
+        {"indn", "parm_index"},
+        {"il", "parm_insert_line"},
+        {"cub", "parm_left_cursor"},
+        {"cuf", "parm_right_cursor"},
+        {"rin", "parm_rindex"},
+        {"cuu", "parm_up_cursor"},
+        {"pfkey", "pkey_key"},
+        {"pfloc", "pkey_local"},
+        {"pfx", "pkey_xmit"},
+        {"mc0", "print_screen"},
+        {"mc4", "prtr_off"},
+        {"mc5", "prtr_on"},
+        {"rep", "repeat_char"},
+        {"rs1", "reset_1string"},
+        {"rs2", "reset_2string"},
+        {"rs3", "reset_3string"},
+        {"rf", "reset_file"},
+        {"rc", "restore_cursor"},
+        {"vpa", "row_address"},
+        {"sc", "save_cursor"},
+        {"ind", "scroll_forward"},
+        {"ri", "scroll_reverse"},
+        {"sgr", "set_attributes"},
+        {"hts", "set_tab"},
+        {"wind", "set_window"},
+        {"ht", "tab"},
+        {"tsl", "to_status_line"},
+        {"uc", "underline_char"},
+        {"hu", "up_half_line"},
+        {"iprog", "init_prog"},
+        {"ka1", "key_a1"},
+        {"ka3", "key_a3"},
+        {"kb2", "key_b2"},
+        {"kc1", "key_c1"},
+        {"kc3", "key_c3"},
+        {"mc5p", "prtr_non"},
+        {"rmp", "char_padding"},
+        {"acsc", "acs_chars"},
+        {"pln", "plab_norm"},
+        {"kcbt", "key_btab"},
+        {"smxon", "enter_xon_mode"},
+        {"rmxon", "exit_xon_mode"},
+        {"smam", "enter_am_mode"},
+        {"rmam", "exit_am_mode"},
+        {"xonc", "xon_character"},
+        {"xoffc", "xoff_character"},
+        {"enacs", "ena_acs"},
+        {"smln", "label_on"},
+        {"rmln", "label_off"},
+        {"kbeg", "key_beg"},
+        {"kcan", "key_cancel"},
+        {"kclo", "key_close"},
+        {"kcmd", "key_command"},
+        {"kcpy", "key_copy"},
+        {"kcrt", "key_create"},
+        {"kend", "key_end"},
+        {"kent", "key_enter"},
+        {"kext", "key_exit"},
+        {"kfnd", "key_find"},
+        {"khlp", "key_help"},
+        {"kmrk", "key_mark"},
+        {"kmsg", "key_message"},
+        {"kmov", "key_move"},
+        {"knxt", "key_next"},
+        {"kopn", "key_open"},
+        {"kopt", "key_options"},
+        {"kprv", "key_previous"},
+        {"kprt", "key_print"},
+        {"krdo", "key_redo"},
+        {"kref", "key_reference"},
+        {"krfr", "key_refresh"},
+        {"krpl", "key_replace"},
+        {"krst", "key_restart"},
+        {"kres", "key_resume"},
+        {"ksav", "key_save"},
+        {"kspd", "key_suspend"},
+        {"kund", "key_undo"},
+        {"kBEG", "key_sbeg"},
+        {"kCAN", "key_scancel"},
+        {"kCMD", "key_scommand"},
+        {"kCPY", "key_scopy"},
+        {"kCRT", "key_screate"},
+        {"kDC", "key_sdc"},
+        {"kDL", "key_sdl"},
+        {"kslt", "key_select"},
+        {"kEND", "key_send"},
+        {"kEOL", "key_seol"},
+        {"kEXT", "key_sexit"},
+        {"kFND", "key_sfind"},
+        {"kHLP", "key_shelp"},
+        {"kHOM", "key_shome"},
+        {"kIC", "key_sic"},
+        {"kLFT", "key_sleft"},
+        {"kMSG", "key_smessage"},
+        {"kMOV", "key_smove"},
+        {"kNXT", "key_snext"},
+        {"kOPT", "key_soptions"},
+        {"kPRV", "key_sprevious"},
+        {"kPRT", "key_sprint"},
+        {"kRDO", "key_sredo"},
+        {"kRPL", "key_sreplace"},
+        {"kRIT", "key_sright"},
+        {"kRES", "key_srsume"},
+        {"kSAV", "key_ssave"},
+        {"kSPD", "key_ssuspend"},
+        {"kUND", "key_sundo"},
+        {"rfi", "req_for_input"},
+        {"kf11", "key_f11"},
+        {"kf12", "key_f12"},
+        {"kf13", "key_f13"},
+        {"kf14", "key_f14"},
+        {"kf15", "key_f15"},
+        {"kf16", "key_f16"},
+        {"kf17", "key_f17"},
+        {"kf18", "key_f18"},
+        {"kf19", "key_f19"},
+        {"kf20", "key_f20"},
+        {"kf21", "key_f21"},
+        {"kf22", "key_f22"},
+        {"kf23", "key_f23"},
+        {"kf24", "key_f24"},
+        {"kf25", "key_f25"},
+        {"kf26", "key_f26"},
+        {"kf27", "key_f27"},
+        {"kf28", "key_f28"},
+        {"kf29", "key_f29"},
+        {"kf30", "key_f30"},
+        {"kf31", "key_f31"},
+        {"kf32", "key_f32"},
+        {"kf33", "key_f33"},
+        {"kf34", "key_f34"},
+        {"kf35", "key_f35"},
+        {"kf36", "key_f36"},
+        {"kf37", "key_f37"},
+        {"kf38", "key_f38"},
+        {"kf39", "key_f39"},
+        {"kf40", "key_f40"},
+        {"kf41", "key_f41"},
+        {"kf42", "key_f42"},
+        {"kf43", "key_f43"},
+        {"kf44", "key_f44"},
+        {"kf45", "key_f45"},
+        {"kf46", "key_f46"},
+        {"kf47", "key_f47"},
+        {"kf48", "key_f48"},
+        {"kf49", "key_f49"},
+        {"kf50", "key_f50"},
+        {"kf51", "key_f51"},
+        {"kf52", "key_f52"},
+        {"kf53", "key_f53"},
+        {"kf54", "key_f54"},
+        {"kf55", "key_f55"},
+        {"kf56", "key_f56"},
+        {"kf57", "key_f57"},
+        {"kf58", "key_f58"},
+        {"kf59", "key_f59"},
+        {"kf60", "key_f60"},
+        {"kf61", "key_f61"},
+        {"kf62", "key_f62"},
+        {"kf63", "key_f63"},
+        {"el1", "clr_bol"},
+        {"mgc", "clear_margins"},
+        {"smgl", "set_left_margin"},
+        {"smgr", "set_right_margin"},
+        {"fln", "label_format"},
+        {"sclk", "set_clock"},
+        {"dclk", "display_clock"},
+        {"rmclk", "remove_clock"},
+        {"cwin", "create_window"},
+        {"wingo", "goto_window"},
+        {"hup", "hangup"},
+        {"dial", "dial_phone"},
+        {"qdial", "quick_dial"},
+        {"tone", "tone"},
+        {"pulse", "pulse"},
+        {"hook", "flash_hook"},
+        {"pause", "fixed_pause"},
+        {"wait", "wait_tone"},
+        {"u0", "user0"},
+        {"u1", "user1"},
+        {"u2", "user2"},
+        {"u3", "user3"},
+        {"u4", "user4"},
+        {"u5", "user5"},
+        {"u6", "user6"},
+        {"u7", "user7"},
+        {"u8", "user8"},
+        {"u9", "user9"},
+        {"op", "orig_pair"},
+        {"oc", "orig_colors"},
+        {"initc", "initialize_color"},
+        {"initp", "initialize_pair"},
+        {"scp", "set_color_pair"},
+        {"setf", "set_foreground"},
+        {"setb", "set_background"},
+        {"cpi", "change_char_pitch"},
+        {"lpi", "change_line_pitch"},
+        {"chr", "change_res_horz"},
+        {"cvr", "change_res_vert"},
+        {"defc", "define_char"},
+        {"swidm", "enter_doublewide_mode"},
+        {"sdrfq", "enter_draft_quality"},
+        {"sitm", "enter_italics_mode"},
+        {"slm", "enter_leftward_mode"},
+        {"smicm", "enter_micro_mode"},
+        {"snlq", "enter_near_letter_quality"},
+        {"snrmq", "enter_normal_quality"},
+        {"sshm", "enter_shadow_mode"},
+        {"ssubm", "enter_subscript_mode"},
+        {"ssupm", "enter_superscript_mode"},
+        {"sum", "enter_upward_mode"},
+        {"rwidm", "exit_doublewide_mode"},
+        {"ritm", "exit_italics_mode"},
+        {"rlm", "exit_leftward_mode"},
+        {"rmicm", "exit_micro_mode"},
+        {"rshm", "exit_shadow_mode"},
+        {"rsubm", "exit_subscript_mode"},
+        {"rsupm", "exit_superscript_mode"},
+        {"rum", "exit_upward_mode"},
+        {"mhpa", "micro_column_address"},
+        {"mcud1", "micro_down"},
+        {"mcub1", "micro_left"},
+        {"mcuf1", "micro_right"},
+        {"mvpa", "micro_row_address"},
+        {"mcuu1", "micro_up"},
+        {"porder", "order_of_pins"},
+        {"mcud", "parm_down_micro"},
+        {"mcub", "parm_left_micro"},
+        {"mcuf", "parm_right_micro"},
+        {"mcuu", "parm_up_micro"},
+        {"scs", "select_char_set"},
+        {"smgb", "set_bottom_margin"},
+        {"smgbp", "set_bottom_margin_parm"},
+        {"smglp", "set_left_margin_parm"},
+        {"smgrp", "set_right_margin_parm"},
+        {"smgt", "set_top_margin"},
+        {"smgtp", "set_top_margin_parm"},
+        {"sbim", "start_bit_image"},
+        {"scsd", "start_char_set_def"},
+        {"rbim", "stop_bit_image"},
+        {"rcsd", "stop_char_set_def"},
+        {"subcs", "subscript_characters"},
+        {"supcs", "superscript_characters"},
+        {"docr", "these_cause_cr"},
+        {"zerom", "zero_motion"},
+        {"csnm", "char_set_names"},
+        {"kmous", "key_mouse"},
+        {"minfo", "mouse_info"},
+        {"reqmp", "req_mouse_pos"},
+        {"getm", "get_mouse"},
+        {"setaf", "set_a_foreground"},
+        {"setab", "set_a_background"},
+        {"pfxl", "pkey_plab"},
+        {"devt", "device_type"},
+        {"csin", "code_set_init"},
+        {"s0ds", "set0_des_seq"},
+        {"s1ds", "set1_des_seq"},
+        {"s2ds", "set2_des_seq"},
+        {"s3ds", "set3_des_seq"},
+        {"smglr", "set_lr_margin"},
+        {"smgtb", "set_tb_margin"},
+        {"birep", "bit_image_repeat"},
+        {"binel", "bit_image_newline"},
+        {"bicr", "bit_image_carriage_return"},
+        {"colornm", "color_names"},
+        {"defbi", "define_bit_image_region"},
+        {"endbi", "end_bit_image_region"},
+        {"setcolor", "set_color_band"},
+        {"slines", "set_page_length"},
+        {"dispc", "display_pc_char"},
+        {"smpch", "enter_pc_charset_mode"},
+        {"rmpch", "exit_pc_charset_mode"},
+        {"smsc", "enter_scancode_mode"},
+        {"rmsc", "exit_scancode_mode"},
+        {"pctrm", "pc_term_options"},
+        {"scesc", "scancode_escape"},
+        {"scesa", "alt_scancode_esc"},
+        {"ehhlm", "enter_horizontal_hl_mode"},
+        {"elhlm", "enter_left_hl_mode"},
+        {"elohlm", "enter_low_hl_mode"},
+        {"erhlm", "enter_right_hl_mode"},
+        {"ethlm", "enter_top_hl_mode"},
+        {"evhlm", "enter_vertical_hl_mode"},
+        {"sgr1", "set_a_attributes"},
+        {"slength", "set_pglen_inch"},
+        {"OTi2", "termcap_init2"},
+        {"OTrs", "termcap_reset"},
+        {"OTnl", "linefeed_if_not_lf"},
+        {"OTbc", "backspace_if_not_bs"},
+        {"OTko", "other_non_function_keys"},
+        {"OTma", "arrow_key_map"},
+        {"OTG2", "acs_ulcorner"},
+        {"OTG3", "acs_llcorner"},
+        {"OTG1", "acs_urcorner"},
+        {"OTG4", "acs_lrcorner"},
+        {"OTGR", "acs_ltee"},
+        {"OTGL", "acs_rtee"},
+        {"OTGU", "acs_btee"},
+        {"OTGD", "acs_ttee"},
+        {"OTGH", "acs_hline"},
+        {"OTGV", "acs_vline"},
+        {"OTGC", "acs_plus"},
+        {"meml", "memory_lock"},
+        {"memu", "memory_unlock"},
+        {"box1", "box_chars_1"}
+    };
+    constexpr uint16_t strDisp[] = {
+        3, 1, 1, 2, 2, 1, 1, 2, 2, 2, 3, 2, 7, 2, 2, 2, 11, 1, 3, 1, 2, 1, 5,
+        3, 1, 1, 1, 4, 2, 1, 3, 5, 1, 1, 0, 7, 1, 2, 4, 2, 1, 2, 1, 1, 1, 10,
+        2, 1, 1, 1, 4, 8, 4, 1, 4, 3, 6, 1, 5, 1, 4, 1, 2, 1, 1, 1, 2, 4, 8,
+        10, 0, 6, 5, 4, 6, 3, 10, 1, 2, 3, 1, 1, 1, 2, 1, 1, 3, 2, 1, 1, 2, 1,
+        3, 7, 1, 4, 2, 2, 1, 4, 4, 3, 1, 2, 15, 2, 5, 1, 4, 1, 1, 7, 2, 5, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 4, 1, 1, 4, 4, 1, 1, 1, 2, 2, 2, 1, 1, 9,
+        8, 6, 1, 1, 1, 2, 6, 5, 12, 7, 1, 1, 1, 2, 8, 2, 1, 1, 15, 1, 1, 4, 1,
+        2, 1, 6, 8, 0, 3, 1, 1, 1, 1, 1, 6, 6, 1, 4, 7, 1, 1, 1, 1, 4, 29, 4,
+        6, 1, 3, 1, 5, 2, 1, 3, 1, 5, 5, 4, 1, 1, 3, 1, 2, 4, 2, 2, 0
+    };
+    constexpr uint16_t strSlots[] = {
+        47, 200, 54, 30, 249, 204, 0, 330, 0, 0, 0, 36, 0, 408, 0, 0, 154, 0,
+        0, 0, 4, 0, 0, 0, 393, 359, 0, 40, 0, 0, 0, 87, 0, 0, 0, 271, 326, 0,
+        0, 65, 148, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 126, 16, 0, 51, 280, 0, 0,
+        0, 149, 81, 0, 233, 0, 0, 0, 0, 412, 0, 0, 39, 157, 0, 0, 0, 0, 373, 0,
+        0, 182, 20, 275, 0, 368, 0, 0, 219, 0, 299, 0, 194, 393, 0, 354, 0, 0,
+        0, 128, 385, 0, 79, 258, 0, 0, 204, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 220,
+        41, 0, 272, 0, 285, 0, 0, 0, 0, 44, 331, 0, 0, 0, 236, 210, 13, 0, 0,
+        28, 223, 0, 129, 0, 0, 0, 0, 0, 323, 0, 168, 144, 0, 129, 0, 0, 0, 0,
+        108, 414, 197, 0, 0, 199, 0, 0, 0, 126, 0, 0, 0, 276, 0, 0, 0, 0, 0, 0,
+        0, 365, 154, 0, 411, 132, 113, 175, 328, 0, 158, 0, 0, 0, 12, 0, 0, 0,
+        0, 83, 375, 169, 0, 0, 363, 0, 9, 115, 0, 389, 0, 215, 183, 0, 0, 12,
+        89, 181, 0, 0, 259, 0, 0, 0, 0, 0, 153, 0, 0, 0, 223, 0, 0, 343, 69,
+        221, 0, 0, 0, 0, 0, 401, 0, 0, 0, 32, 0, 0, 0, 270, 246, 0, 0, 329, 0,
+        0, 300, 0, 0, 32, 0, 0, 356, 0, 278, 0, 0, 9, 0, 0, 0, 0, 0, 405, 0,
+        136, 289, 399, 210, 0, 395, 315, 0, 0, 310, 0, 52, 117, 398, 0, 147, 0,
+        0, 85, 0, 172, 303, 352, 0, 0, 0, 0, 93, 297, 109, 0, 0, 0, 0, 0, 121,
+        0, 0, 330, 391, 0, 113, 0, 0, 0, 413, 0, 0, 0, 0, 0, 358, 0, 0, 0, 0,
+        280, 0, 0, 209, 0, 15, 0, 312, 0, 396, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 77, 0, 0, 0, 340, 0, 0, 14, 0, 0, 0, 225, 0, 383, 0, 0, 0, 0, 137,
+        0, 324, 275, 0, 0, 91, 0, 80, 0, 384, 0, 0, 159, 0, 205, 136, 0, 0, 0,
+        0, 403, 410, 0, 0, 0, 167, 206, 0, 0, 160, 0, 0, 0, 11, 380, 0, 0, 37,
+        194, 0, 0, 0, 232, 314, 0, 0, 0, 144, 0, 0, 0, 24, 0, 0, 0, 0, 0, 76,
+        0, 143, 0, 0, 0, 400, 56, 0, 0, 0, 0, 0, 0, 46, 0, 0, 404, 0, 0, 356,
+        238, 23, 91, 394, 0, 0, 0, 0, 0, 0, 0, 0, 0, 343, 0, 0, 0, 0, 0, 0, 7,
+        334, 0, 0, 62, 0, 0, 0, 0, 121, 0, 258, 0, 0, 202, 0, 0, 0, 0, 0, 382,
+        165, 0, 0, 0, 85, 412, 0, 171, 0, 0, 405, 292, 0, 0, 0, 0, 294, 0, 203,
+        0, 92, 0, 173, 0, 0, 0, 0, 0, 151, 0, 178, 0, 0, 333, 0, 332, 0, 394,
+        14, 0, 0, 167, 0, 406, 0, 303, 336, 0, 134, 0, 7, 0, 0, 0, 161, 310, 0,
+        0, 0, 0, 180, 0, 381, 0, 0, 0, 0, 0, 0, 0, 67, 0, 0, 0, 306, 0, 124, 0,
+        6, 0, 0, 0, 106, 253, 0, 297, 125, 222, 0, 0, 195, 50, 0, 344, 0, 296,
+        0, 0, 241, 0, 0, 0, 0, 0, 382, 0, 68, 0, 30, 33, 0, 0, 0, 59, 0, 0, 0,
+        227, 0, 0, 0, 0, 0, 257, 130, 379, 209, 8, 0, 0, 372, 0, 300, 20, 401,
+        365, 0, 0, 0, 350, 0, 0, 0, 0, 5, 0, 317, 0, 0, 96, 264, 114, 0, 191,
+        0, 0, 0, 26, 0, 0, 0, 0, 0, 100, 48, 0, 0, 0, 79, 377, 325, 74, 0, 0,
+        0, 231, 0, 410, 291, 0, 0, 0, 0, 190, 108, 0, 0, 0, 221, 16, 0, 0, 0,
+        327, 0, 0, 0, 263, 0, 0, 0, 0, 0, 0, 0, 230, 76, 0, 298, 0, 0, 87, 0,
+        138, 301, 0, 0, 0, 281, 0, 0, 0, 45, 0, 0, 11, 66, 0, 0, 294, 0, 0,
+        392, 351, 292, 0, 0, 0, 374, 0, 0, 0, 0, 0, 379, 24, 0, 44, 0, 0, 0,
+        309, 0, 72, 26, 166, 0, 0, 304, 0, 0, 168, 0, 0, 0, 0, 0, 0, 82, 282,
+        244, 0, 184, 150, 237, 134, 346, 0, 0, 173, 363, 172, 0, 212, 0, 0, 0,
+        137, 0, 387, 0, 0, 116, 0, 0, 33, 0, 0, 120, 0, 188, 298, 0, 0, 0, 0,
+        49, 0, 0, 141, 0, 0, 119, 0, 299, 127, 0, 293, 0, 0, 0, 0, 135, 0, 127,
+        386, 0, 0, 0, 269, 162, 0, 192, 49, 0, 0, 339, 94, 0, 217, 0, 208, 0,
+        216, 0, 0, 152, 0, 0, 0, 378, 0, 0, 231, 0, 0, 358, 0, 0, 170, 0, 179,
+        53, 0, 19, 360, 286, 331, 0, 0, 315, 0, 0, 0, 255, 0, 213, 110, 0, 0,
+        158, 0, 0, 313, 0, 0, 0, 0, 218, 211, 0, 0, 360, 0, 0, 335, 317, 0,
+        234, 188, 0, 0, 0, 0, 290, 0, 0, 196, 0, 0, 0, 232, 247, 17, 403, 2, 0,
+        0, 366, 117, 0, 0, 0, 265, 0, 0, 0, 58, 0, 0, 0, 0, 0, 345, 89, 0, 0,
+        37, 0, 0, 3, 0, 0, 104, 0, 0, 38, 96, 58, 0, 287, 0, 0, 22, 0, 0, 0,
+        187, 0, 0, 0, 100, 0, 0, 0, 72, 376, 5, 0, 0, 325, 166, 378, 0, 0, 0,
+        0, 0, 84, 366, 122, 414, 0, 0, 362, 27, 0, 0, 0, 0, 0, 86, 388, 0, 0,
+        229, 0, 0, 212, 319, 0, 0, 0, 0, 0, 90, 0, 0, 0, 0, 165, 36, 308, 0,
+        281, 361, 0, 0, 155, 145, 0, 189, 0, 242, 0, 285, 0, 186, 274, 82, 0,
+        0, 248, 0, 150, 397, 73, 0, 0, 0, 18, 0, 0, 19, 399, 0, 0, 0, 0, 114,
+        0, 62, 0, 0, 174, 0, 0, 0, 353, 53, 0, 191, 0, 0, 279, 0, 372, 0, 0, 0,
+        0, 0, 217, 176, 408, 0, 0, 21, 262, 0, 0, 0, 306, 0, 52, 0, 0, 0, 0, 0,
+        277, 0, 163, 0, 0, 387, 0, 0, 0, 0, 65, 0, 77, 0, 177, 0, 78, 0, 0, 0,
+        0, 0, 0, 0, 139, 181, 0, 241, 39, 0, 0, 0, 0, 8, 0, 1, 0, 0, 0, 0, 123,
+        308, 347, 371, 287, 0, 0, 31, 238, 0, 267, 148, 341, 74, 0, 373, 42,
+        332, 0, 193, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 329, 0, 0, 0, 61, 0,
+        0, 196, 29, 0, 263, 0, 0, 139, 0, 0, 18, 0, 0, 0, 0, 0, 289, 0, 0, 141,
+        391, 0, 0, 142, 392, 250, 97, 125, 0, 388, 0, 214, 0, 240, 339, 60, 0,
+        135, 0, 261, 0, 0, 198, 84, 406, 0, 0, 0, 0, 0, 0, 0, 326, 0, 0, 0, 0,
+        0, 312, 111, 216, 314, 29, 0, 199, 0, 15, 81, 0, 169, 390, 164, 75,
+        367, 0, 99, 0, 64, 0, 0, 140, 142, 295, 0, 0, 25, 0, 0, 68, 111, 51, 0,
+        0, 0, 0, 321, 402, 0, 0, 0, 0, 0, 42, 185, 0, 0, 264, 0, 237, 386, 305,
+        0, 0, 357, 0, 200, 151, 0, 0, 101, 320, 0, 0, 0, 55, 0, 0, 0, 380, 0,
+        71, 0, 156, 161, 0, 0, 175, 0, 0, 131, 0, 226, 116, 0, 0, 0, 0, 0, 0,
+        0, 0, 184, 0, 0, 0, 0, 0, 361, 0, 94, 0, 0, 0, 0, 109, 0, 0, 0, 0, 0,
+        147, 17, 0, 348, 0, 0, 0, 335, 0, 397, 222, 0, 273, 0, 260, 0, 0, 0, 0,
+        0, 123, 0, 0, 0, 0, 407, 0, 0, 0, 0, 0, 270, 0, 0, 260, 0, 0, 46, 390,
+        55, 0, 240, 0, 0, 92, 178, 0, 0, 0, 0, 0, 103, 10, 0, 243, 0, 0, 0,
+        192, 347, 407, 243, 0, 0, 245, 0, 370, 0, 355, 0, 0, 112, 395, 0, 364,
+        0, 0, 0, 0, 226, 0, 277, 0, 0, 370, 6, 0, 0, 341, 0, 327, 0, 0, 0, 276,
+        324, 0, 254, 0, 0, 230, 345, 307, 197, 0, 0, 350, 0, 0, 0, 0, 138, 45,
+        0, 0, 0, 0, 252, 0, 0, 0, 0, 0, 0, 313, 316, 250, 0, 0, 54, 0, 0, 0, 0,
+        0, 155, 0, 0, 69, 0, 296, 0, 396, 0, 0, 0, 353, 0, 0, 338, 266, 80, 0,
+        385, 0, 0, 0, 0, 0, 130, 0, 0, 0, 333, 235, 43, 99, 0, 0, 0, 251, 0,
+        25, 0, 0, 0, 0, 0, 0, 0, 152, 369, 0, 0, 268, 50, 202, 336, 251, 0, 0,
+        0, 0, 0, 0, 0, 0, 254, 0, 271, 0, 0, 215, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        288, 0, 0, 0, 0, 295, 47, 0, 268, 269, 0, 290, 0, 0, 40, 162, 0, 107,
+        0, 0, 404, 257, 187, 73, 0, 233, 255, 0, 321, 207, 4, 0, 0, 90, 13,
+        381, 115, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 279, 0, 0, 374,
+        322, 0, 0, 262, 153, 0, 27, 103, 0, 220, 0, 342, 0, 371, 368, 48, 0,
+        253, 311, 0, 0, 0, 0, 120, 78, 211, 0, 0, 0, 0, 228, 0, 0, 0, 119, 0,
+        170, 0, 0, 0, 63, 0, 0, 0, 348, 0, 384, 0, 0, 383, 21, 0, 0, 0, 23, 0,
+        0, 75, 0, 0, 0, 283, 0, 0, 163, 34, 334, 83, 377, 0, 60, 0, 319, 195,
+        0, 105, 0, 95, 0, 190, 351, 256, 0, 322, 97, 252, 274, 86, 0, 224, 0,
+        0, 0, 265, 205, 0, 0, 203, 0, 362, 206, 0, 0, 0, 0, 320, 207, 229, 0,
+        0, 375, 0, 0, 35, 0, 0, 63, 249, 22, 0, 0, 0, 302, 0, 0, 176, 0, 0, 0,
+        128, 133, 0, 0, 0, 402, 0, 0, 0, 159, 38, 0, 164, 0, 364, 0, 146, 0,
+        34, 0, 0, 0, 0, 0, 0, 0, 0, 179, 0, 291, 0, 0, 0, 0, 140, 398, 1, 70,
+        0, 0, 0, 0, 409, 0, 0, 132, 0, 0, 318, 0, 0, 352, 0, 340, 0, 0, 354, 0,
+        0, 367, 0, 0, 88, 219, 224, 0, 0, 0, 0, 273, 316, 0, 284, 0, 218, 0, 0,
+        112, 0, 0, 0, 183, 182, 146, 0, 0, 107, 337, 0, 0, 0, 0, 0, 266, 239,
+        0, 0, 0, 57, 234, 272, 0, 0, 246, 318, 133, 0, 337, 208, 70, 413, 411,
+        409, 338, 0, 301, 0, 288, 239, 67, 93, 0, 0, 0, 56, 0, 160, 0, 0, 0, 0,
+        261, 0, 0, 0, 57, 201, 0, 0, 214, 156, 0, 0, 0, 0, 0, 267, 259, 41, 0,
+        0, 0, 71, 0, 389, 185, 0, 0, 0, 0, 0, 98, 0, 0, 102, 98, 0, 0, 235,
+        110, 0, 177, 307, 0, 293, 0, 122, 0, 0, 349, 0, 0, 346, 236, 189, 61,
+        0, 0, 256, 104, 0, 0, 95, 149, 66, 0, 0, 59, 355, 0, 0, 43, 0, 245,
+        101, 143, 171, 0, 0, 0, 0, 0, 0, 357, 213, 0, 0, 186, 0, 0, 88, 0, 0,
+        105, 278, 174, 0, 0, 227, 0, 0, 0, 0, 225, 0, 0, 247, 0, 31, 145, 0,
+        131, 342, 0, 0, 2, 0, 0, 0, 0, 0, 282, 0, 0, 0, 248, 0, 0, 0, 311, 0,
+        180, 3, 0, 28, 0, 0, 0, 0, 0, 0, 0, 0, 0, 102, 328, 157, 369, 0, 0, 0,
+        0, 0, 64, 35, 228, 400, 0, 0, 309, 124, 0, 0, 359, 0, 0, 193, 0, 118,
+        118, 349, 0, 323, 0, 0, 0, 0, 0, 244, 198, 0, 344, 10, 106, 286, 376,
+        305, 304, 0, 242, 201, 0, 0, 0, 302, 0, 0, 0
+    };
+}  // namespace detail
+// END capability names
+
+namespace detail {
+    /*
+        Every short and long name hashes to a distinct slot once its
+        bucket's displacement is applied, so a lookup is two hashes and a
+        single comparison. Slots hold the enum value + 1, 0 being empty.
+    */
+    constexpr int nameAt(const CapName *names, uint16_t slot, const char *s,
+                         std::size_t n)
     {
-        name.clear();
-        booleans.reset();
-        numbers.fill(std::numeric_limits<uint16_t>::max());
-        stringOffset.clear();
-        stringTable.clear();
-        const auto error = loadDB(_name, _path);
-        isValidState     = error ? false : true;
-        return isValidState;
+        return slot != 0 && (sameName(names[slot - 1].shortName, s, n) ||
+                             sameName(names[slot - 1].longName, s, n))
+                   ? slot - 1
+                   : -1;
     }
-
-    bool get(tdb::bin _b) const noexcept
+    template <std::size_t buckets, std::size_t slots>
+    constexpr int findName(const CapName *names,
+                           const uint16_t (&disp)[buckets],
+                           const uint16_t (&slot)[slots], const char *s,
+                           std::size_t n)
     {
-        const auto b = static_cast<int>(_b);
-        return booleans[b];
+        return nameAt(names,
+                      slot[nameHash(s, n, disp[nameHash(s, n, 0) % buckets]) %
+                           slots],
+                      s, n);
     }
 
-    nonstd::optional<uint16_t> get(tdb::num _n) const noexcept
+    template <typename Cap>
+    constexpr Cap capByName(int index)
     {
-        // NP represents 'Not Present' properties, represented by
-        // -1 value in terminfo databases.
-        const auto n      = static_cast<int>(_n);
-        const auto result = numbers[n];
-        if (result == std::numeric_limits<uint16_t>::max()) {
-            return {};
-        } else {
-            return result;
-        }
+        return index < 0 ? throw std::invalid_argument("unknown capability")
+                         : static_cast<Cap>(index);
     }
+}  // namespace detail
 
-    std::string get(tdb::str _s, param p1 = 0l, param p2 = 0l, param p3 = 0l,
-                    param p4 = 0l, param p5 = 0l, param p6 = 0l, param p7 = 0l,
-                    param p8 = 0l, param p9 = 0l) const
-    {
-        static const std::regex pattern(delayStr, std::regex::optimize);
+// enum <-> name, accepting either the short or the long name. The
+// *ByName() variants work in constant expressions and throw on unknown
+// names, find*() is meant for names coming in at runtime.
+constexpr const char *shortName(bin cap)
+{
+    return detail::binNames[static_cast<int>(cap)].shortName;
+}
+constexpr const char *shortName(num cap)
+{
+    return detail::numNames[static_cast<int>(cap)].shortName;
+}
+constexpr const char *shortName(str cap)
+{
+    return detail::strNames[static_cast<int>(cap)].shortName;
+}
+constexpr const char *longName(bin cap)
+{
+    return detail::binNames[static_cast<int>(cap)].longName;
+}
+constexpr const char *longName(num cap)
+{
+    return detail::numNames[static_cast<int>(cap)].longName;
+}
+constexpr const char *longName(str cap)
+{
+    return detail::strNames[static_cast<int>(cap)].longName;
+}
 
-        const size_t s = static_cast<int>(_s);
-        std::string result;
+constexpr bin binByName(const char *name)
+{
+    return detail::capByName<bin>(detail::findName(
+        detail::binNames, detail::binDisp, detail::binSlots, name,
+        detail::nameLength(name)));
+}
+constexpr num numByName(const char *name)
+{
+    return detail::capByName<num>(detail::findName(
+        detail::numNames, detail::numDisp, detail::numSlots, name,
+        detail::nameLength(name)));
+}
+constexpr str strByName(const char *name)
+{
+    return detail::capByName<str>(detail::findName(
+        detail::strNames, detail::strDisp, detail::strSlots, name,
+        detail::nameLength(name)));
+}
 
-        if (!stringOffset.empty() && s < stringOffset.size()) {
-            const auto offset      = stringOffset[s];
-            constexpr auto INVALID = std::numeric_limits<uint16_t>::max();
-            if (offset != INVALID && offset < stringTable.size()) {
-                result.append(&stringTable[offset]);
-                escape(result);
-                result = std::regex_replace(result, pattern, "");
-                result = parser(result, p1, p2, p3, p4, p5, p6, p7, p8, p9);
-            }
+inline nonstd::optional<bin> findBin(const std::string &name)
+{
+    int index = detail::findName(detail::binNames, detail::binDisp,
+                                 detail::binSlots, name.data(), name.size());
+    if (index < 0) return nonstd::nullopt;
+    return static_cast<bin>(index);
+}
+inline nonstd::optional<num> findNum(const std::string &name)
+{
+    int index = detail::findName(detail::numNames, detail::numDisp,
+                                 detail::numSlots, name.data(), name.size());
+    if (index < 0) return nonstd::nullopt;
+    return static_cast<num>(index);
+}
+inline nonstd::optional<str> findStr(const std::string &name)
+{
+    int index = detail::findName(detail::strNames, detail::strDisp,
+                                 detail::strSlots, name.data(), name.size());
+    if (index < 0) return nonstd::nullopt;
+    return static_cast<str>(index);
+}
+
+
+namespace detail {
+    // read-only run of values, over a container or inside an Arena
+    template <typename T>
+    class View {
+        const T *first    = nullptr;
+        std::size_t count = 0;
+
+    public:
+        View() = default;
+        constexpr View(const T *_first, std::size_t _count) noexcept
+            : first(_first), count(_count)
+        {
+        }
+        template <typename C>
+        explicit View(const C &c) noexcept : first(c.data()), count(c.size())
+        {
         }
-        return result;
-    }
-};
 
+        const T &operator[](std::size_t i) const noexcept { return first[i]; }
+        const T *data() const noexcept { return first; }
+        std::size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+    };
 
-std::error_code TermDb::loadDB(const std::string _name, std::string _path)
-{
+    /*
+        One cache line aligned block for everything a loaded description
+        reads. The same parts are placed twice, the first pass only sizes
+        the block and returns views of the parts as they are, allocate()
+        then switches to copying them in.
+    */
+    class Arena {
+        struct Free {
+            void operator()(void *p) const noexcept { std::free(p); }
+        };
+        std::unique_ptr<void, Free> block;
+        uint8_t *base        = nullptr;
+        std::size_t used     = 0;
+        std::size_t capacity = 0;
+        bool filling         = false;
 
-    const auto hashCharacter = [](unsigned char c) {
-        if (c < 10) {
-            return c + '0';
-        } else {
-            return (c - 10) + 'a';
+    public:
+        enum : std::size_t { alignment = 64 };
+
+        template <typename T>
+        View<T> place(const T *data, std::size_t n)
+        {
+            static_assert(std::is_trivially_copyable<T>::value,
+                          "parts are copied bytewise");
+            used = (used + alignof(T) - 1) / alignof(T) * alignof(T);
+            const auto at = used;
+            used += n * sizeof(T);
+            if (!filling || n == 0) {
+                return View<T>(data, n);
+            }
+            const auto copy = reinterpret_cast<T *>(base + at);
+            std::memcpy(copy, data, n * sizeof(T));
+            return View<T>(copy, n);
+        }
+
+        template <typename C>
+        View<typename C::value_type> place(const C &c)
+        {
+            return place(c.data(), c.size());
+        }
+
+        void allocate()
+        {
+            capacity = (used + alignment - 1) / alignment * alignment;
+            used     = 0;
+            filling  = true;
+            if (capacity == 0) {
+                return;
+            }
+#ifdef TDB_POSIX
+            void *p = nullptr;
+            if (::posix_memalign(&p, alignment, capacity) != 0) {
+                throw std::bad_alloc{};
+            }
+            block.reset(p);
+            base = static_cast<uint8_t *>(p);
+#else
+            block.reset(std::malloc(capacity + alignment - 1));
+            if (!block) {
+                throw std::bad_alloc{};
+            }
+            const auto at = reinterpret_cast<std::uintptr_t>(block.get());
+            base = static_cast<uint8_t *>(block.get())
+              + (alignment - at % alignment) % alignment;
+#endif
         }
+
+        std::size_t size() const noexcept { return capacity; }
     };
+}  // namespace detail
 
-    std::error_code ec = tdb::ParseError::Success;
-    if (_name.empty() || _path.empty()) {
-        ec = tdb::ParseError::ReadError;
-        return ec;
-    }
 
+namespace detail {
+    /*
+        String capabilities are compiled once, when the database is
+        loaded, into a small stack machine program. Literal runs point
+        into a shared text pool, so running a capability with no
+        parameters costs a single append.
+    */
+    enum class Op : uint8_t {
+        Literal,     // append text[val, val + len)
+        PushParam,   // %p[1-9], arg is the param index
+        PushConst,   // %'c' and %{nn}, val is the constant
+        GetVar,      // %g[a-zA-Z], arg is the variable index
+        SetVar,      // %P[a-zA-Z], arg is the variable index
+        StrLen,      // %l
+        Increment,   // %i
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Mod,
+        BitAnd,
+        BitOr,
+        BitXor,
+        Eq,
+        Gt,
+        Lt,
+        And,
+        Or,
+        Not,
+        Compl,
+        PutChar,     // %c
+        PutNumber,   // %[[:]flags][width[.precision]][doxX]
+        PutString,   // %[[:]flags][width[.precision]]s
+        JumpIfZero,  // %t, val is the jump target
+        Jump         // %e, val is the jump target
+    };
+
+    // printf flags of PutNumber/PutString, stored in Instr::arg
+    enum : uint8_t {
+        FmtLeft  = 1 << 0,
+        FmtSign  = 1 << 1,
+        FmtAlt   = 1 << 2,
+        FmtSpace = 1 << 3,
+        FmtZero  = 1 << 4,
+        FmtOct   = 1 << 5,
+        FmtHex   = 1 << 6,
+        FmtUpper = 1 << 7
+    };
 
-    std::string tryPath = _path;
-    tryPath.append(_name, 0, 1).append(1, '/').append(_name);
-    std::ifstream db(tryPath.c_str(), std::ios::binary | std::ios::ate);
-    if (!db) {
-        // try using hash value
-        char hash[2];
-        unsigned char firstchar = _name[0];
+    struct Instr {
+        Op op;
+        uint8_t arg;   // param/variable index or format flags
+        uint16_t len;  // literal length or field width
+        int32_t val;   // text offset, constant, jump target or precision
+    };
 
-        hash[0] = hashCharacter((firstchar & 0xF0) >> 4);
-        hash[1] = hashCharacter(firstchar & 0x0F);
-        _path.append(&hash[0], 2).append(1, '/').append(_name);
+    // location of a compiled capability inside Bytecode::code
+    struct Program {
+        enum : uint8_t {
+            UsesDynamic = 1 << 0,  // %P[a-z] or %g[a-z]
+            UsesStatic  = 1 << 1   // %P[A-Z] or %g[A-Z]
+        };
+        uint32_t begin   = 0;
+        uint16_t size    = 0;
+        bool valid       = false;
+        uint8_t flags    = 0;
+        uint8_t arity    = 0;  // highest %p[1-9] used
+        uint16_t strings = 0;  // bit n set if %p<n+1> is used as a string
+
+        Program() = default;
+        constexpr Program(uint32_t _begin, uint16_t _size, bool _valid,
+                          uint8_t _flags, uint8_t _arity,
+                          uint16_t _strings) noexcept
+            : begin(_begin),
+              size(_size),
+              valid(_valid),
+              flags(_flags),
+              arity(_arity),
+              strings(_strings)
+        {
+        }
+    };
 
-        db.clear();
-        db.open(_path, std::ios::binary | std::ios::ate);
+    // padding of a capability, from its $<n> markers
+    struct Padding {
+        enum : uint8_t {
+            Proportional = 1 << 0,  // $<n*>, per affected line
+            Mandatory    = 1 << 1   // $<n/>, even with xon_xoff
+        };
+        uint32_t delay = 0;  // tenths of milliseconds
+        uint8_t flags  = 0;
 
-        if (!db) {
-            ec = tdb::ParseError::ReadError;
-            return ec;
+        Padding() = default;
+        constexpr Padding(uint32_t _delay, uint8_t _flags) noexcept
+            : delay(_delay), flags(_flags)
+        {
         }
-    }
+    };
 
-    const int size = db.tellg();
-    if (size == 0) {
-        ec = tdb::ParseError::BadDatabase;
-        return ec;
-    }
+    Padding stripDelays(std::string &);
 
+    using Variables = std::array<param, 26>;
 
-    db.seekg(0, std::ios::beg);
-    std::vector<uint8_t> buffer(size);
-    db.read(reinterpret_cast<char *>(buffer.data()), size);
-    db.close();
+    // the interpreter runs on param values, or on plain longs when every
+    // argument is an integer and the program cannot meet a string
+    inline bool isNumber(const param &v) noexcept
+    {
+        return mpark::holds_alternative<long>(v);
+    }
+    constexpr bool isNumber(long) noexcept { return true; }
+    inline long &numberOf(param &v) { return mpark::get<long>(v); }
+    inline long &numberOf(long &v) noexcept { return v; }
+    inline const std::string *stringOf(const param &v) noexcept
+    {
+        return mpark::get_if<std::string>(&v);
+    }
+    constexpr const std::string *stringOf(long) noexcept { return nullptr; }
 
-    if (db.fail()) {
-        ec = tdb::ParseError::ReadError;
-        return ec;
+    // arguments of TermDb::get() and friends
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, param>::type
+    toParam(T v)
+    {
+        return static_cast<long>(v);
     }
+    inline param toParam(const char *s) { return std::string(s); }
+    inline param toParam(std::string s) { return param(std::move(s)); }
+    inline param toParam(param p) { return p; }
 
+    template <typename... Ts>
+    struct AllIntegral : std::true_type {
+    };
+    template <typename T, typename... Ts>
+    struct AllIntegral<T, Ts...>
+        : std::integral_constant<
+            bool, std::is_integral<typename std::decay<T>::type>::value
+                    && AllIntegral<Ts...>::value> {
+    };
 
-    // sanitize if no at-the-end null byte present
-    buffer.push_back('\0');
+    /*
+        Static variables %P[A-Z] keep their values across calls, they
+        belong to one TermDb and are guarded by its lock. Dynamic
+        variables %P[a-z] only live for one call.
+    */
+    class StaticVariables {
+        mutable std::mutex lock;
+        Variables values{};
 
-    // header contains a constant magic number
-    const auto magic_byte = buffer[0] | (buffer[1] << 8);
-    if (magic_byte != 0432) {
-        ec = tdb::ParseError::MagicByteError;
-        return ec;
-    }
+    public:
+        StaticVariables() = default;
+        StaticVariables(const StaticVariables &other) : values(other.copy()) {}
 
+        StaticVariables &operator=(const StaticVariables &other)
+        {
+            if (this != &other) {
+                auto v = other.copy();
+                std::lock_guard<std::mutex> guard(lock);
+                values = std::move(v);
+            }
+            return *this;
+        }
 
-    /* size list contains size/numbers of -
-      - name [0]
-      - booleans [1]
-      - numbers [2]
-      - offsets [3]
-      - stringTable [4]
-    */
-    uint16_t sList[5] = { 0 };
-    for (auto i = 2, j = 0; i < 12; i += 2, ++j) {
-        sList[j] = buffer[i] | (buffer[i + 1] << 8);
-    }
+        Variables copy() const
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return values;
+        }
 
+        void reset()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            values.fill(0l);
+        }
 
-    // check for malformed databases
-    const std::size_t minBytes
-      = 12 + sList[0] + sList[1] + ((sList[2] + sList[3]) * 2) + sList[4];
-    if (buffer.size() <= minBytes) {
-        ec = tdb::ParseError::BadDatabase;
-        return ec;
-    }
+        // callers hold mutex() while using the values
+        std::mutex &mutex() const noexcept { return lock; }
+        Variables &get() noexcept { return values; }
+    };
 
-    // parse name of terms
-    name.append(buffer.begin() + 12, buffer.begin() + 11 + sList[0]);
+    // output of Bytecode::execute() into a caller provided buffer, counts
+    // the bytes that did not fit
+    class BufferWriter {
+        char *buf;
+        std::size_t cap;
+        std::size_t len = 0;
 
-    // parse boolean values
-    int cursor = 12 + sList[0];
-    for (auto i = cursor; i < cursor + sList[1]; ++i) {
-        if (buffer[i]) {
-            booleans.set(i - cursor);
+    public:
+        BufferWriter(char *_buf, std::size_t _cap) noexcept
+            : buf(_buf), cap(_cap)
+        {
         }
-    }
-    cursor += sList[1];
 
+        void append(const char *s, std::size_t n) noexcept
+        {
+            if (len < cap) {
+                std::memcpy(buf + len, s, std::min(n, cap - len));
+            }
+            len += n;
+        }
 
-    /*
-        Between the boolean section and the number section, a null
-        byte will be inserted, if necessary, to ensure that the
-        number section begins on an even byte (this is a relic of
-        the PDP-11's word-addressed architecture, originally
-        designed in to avoid IOT traps induced by addressing a
-        word on an odd byte boundary). All short integers are
-        aligned on a short word boundary.
-    */
-    cursor += cursor % 2;
+        void push_back(const char c) noexcept
+        {
+            if (len < cap) {
+                buf[len] = c;
+            }
+            ++len;
+        }
+
+        std::size_t size() const noexcept { return len; }
+        // drops what was written past 'n'
+        void resize(std::size_t n) noexcept { len = std::min(len, n); }
+    };
 
+    // output into a std::string that is grown ahead and trimmed by
+    // finish(), which saves the bookkeeping of many small appends
+    class StringWriter {
+        std::string &str;
+        std::size_t len;
 
-    // parse numbers values
-    for (auto i = cursor, j = 0; j < sList[2]; i += 2, ++j) {
-        numbers[j] = buffer[i] | (buffer[i + 1] << 8);
-    }
-    cursor += sList[2] * 2;
+        void reserve(std::size_t n)
+        {
+            if (len + n > str.size()) {
+                str.resize(std::max(str.size() * 2, len + n));
+            }
+        }
 
+    public:
+        StringWriter(std::string &_str, std::size_t expected)
+            : str(_str), len(_str.size())
+        {
+            str.resize(len + expected);
+        }
 
-    // parse stringOffset values
-    stringOffset.resize(sList[3], 0);
-    for (auto i = cursor, j = 0; j < sList[3]; i += 2, ++j) {
-        stringOffset[j] = buffer[i] | (buffer[i + 1] << 8);
-    }
-    cursor += sList[3] * 2;
+        void append(const char *s, std::size_t n)
+        {
+            reserve(n);
+            std::memcpy(&str[len], s, n);
+            len += n;
+        }
 
+        void push_back(const char c)
+        {
+            reserve(1);
+            str[len++] = c;
+        }
 
-    // move rest of the buffer to string table
-    std::move(buffer.begin() + cursor, buffer.end(),
-              std::inserter(stringTable, stringTable.begin()));
+        std::size_t size() const noexcept { return len; }
+        void resize(std::size_t n) noexcept { len = std::min(len, n); }
+        void finish() { str.resize(len); }
+    };
 
-    return ec;
-}
+    class Bytecode {
+        template <typename Out>
+        static void format(const Instr &, long, const std::string *, Out &);
+        void inferSignature(Program &) const;
 
-void TermDb::escape(std::string &input) const
-{
-    const auto isDigit = [](const char c) { return (c >= '0' && c <= '9'); };
+        bool compileProgram(const std::string &, Program &);
 
-    std::string result;
-    auto strLength   = input.length();
-    bool activeParse = false;
-    errno            = 0;
+    public:
+        // while compiling, instrs and chars is what execute() reads
+        std::vector<Instr> code;
+        std::string text;
+        View<Instr> instrs;
+        View<char> chars;
 
-    for (decltype(strLength) i = 0; i < strLength; ++i) {
+        bool compile(const std::string &s, Program &prog)
+        {
+            const auto compiled = compileProgram(s, prog);
+            instrs              = View<Instr>(code);
+            chars               = View<char>(text);
+            return compiled;
+        }
 
-        if (!activeParse) {
-            if (input[i] == '\\') {
-                activeParse = true;
-            } else {
-                result += input[i];
+        // moves instrs and chars into 'arena', see Description::pack()
+        void pack(Arena &arena)
+        {
+            instrs = arena.place(code);
+            chars  = arena.place(text);
+        }
+
+        // frees what compiling built once it was packed
+        void release() noexcept
+        {
+            std::vector<Instr>().swap(code);
+            std::string().swap(text);
+        }
+
+        // Out is std::string or BufferWriter, Value is param or long.
+        // statics may be null for programs without Program::UsesStatic
+        template <typename Out, typename Value>
+        bool execute(const Program &, std::array<Value, 9> &,
+                     std::array<Value, 26> *, Out &) const;
+
+        // runs a program, taking the lock of the static variables only
+        // if the program uses them
+        template <typename Out>
+        bool execute(const Program &prog, std::array<param, 9> &p,
+                     StaticVariables &statics, Out &out) const
+        {
+            if (prog.flags & Program::UsesStatic) {
+                std::lock_guard<std::mutex> guard(statics.mutex());
+                return execute(prog, p, &statics.get(), out);
             }
-            continue;
+            return execute(prog, p, static_cast<Variables *>(nullptr), out);
         }
 
-        switch (input[i]) {
+        // integer only arguments, for programs that take no string and
+        // use no static variable
+        template <typename Out>
+        bool execute(const Program &prog, std::array<long, 9> &p,
+                     Out &out) const
+        {
+            return execute(
+              prog, p, static_cast<std::array<long, 26> *>(nullptr), out);
+        }
+
+        void clear() noexcept
+        {
+            code.clear();
+            text.clear();
+            instrs = {};
+            chars  = {};
+        }
+    };
+}  // namespace detail
+
+
+namespace detail {
+    /*
+        Contents of a database file. Where mmap is available a large file
+        is mapped read-only and shared with the page cache, otherwise it
+        is read into a buffer. In practice only an Image is that large, a
+        compiled entry is a few KiB and copied out of the input by its
+        Description anyway, for those mmap and munmap cost more than
+        reading. Either way the bytes stay put until the object is
+        destroyed.
+    */
+    class FileData {
+        // smaller files are read even when mapping is asked for
+        static constexpr std::size_t mapThreshold = 64 * 1024;
+
+        std::vector<uint8_t> buffer;
+        void *mapping    = nullptr;
+        std::size_t size = 0;
+
+    public:
+        FileData() = default;
+        FileData(const FileData &) = delete;
+        FileData &operator=(const FileData &) = delete;
+        ~FileData() { close(); }
+
+        const uint8_t *data() const noexcept
+        {
+            return mapping ? static_cast<const uint8_t *>(mapping)
+                           : buffer.data();
+        }
+        std::size_t length() const noexcept { return size; }
+
+        void close() noexcept
+        {
+#ifdef TDB_MMAP
+            if (mapping) {
+                ::munmap(mapping, size);
+            }
+#endif
+            mapping = nullptr;
+            size    = 0;
+            buffer.clear();
+        }
+
+        // ReadError if the file can't be opened or read, BadDatabase if
+        // it is empty, 'map' allows mapping files of mapThreshold bytes
+        // and more
+        std::error_code open(const std::string &path, bool map = true)
+        {
+            close();
+#ifdef TDB_MMAP
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return ParseError::ReadError;
+            }
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                return ParseError::ReadError;
+            }
+            if (st.st_size == 0) {
+                ::close(fd);
+                return ParseError::BadDatabase;
+            }
+            const auto length = static_cast<std::size_t>(st.st_size);
+            if (map && length >= mapThreshold) {
+                auto m = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                ::close(fd);
+                if (m == MAP_FAILED) {
+                    return ParseError::ReadError;
+                }
+                mapping = m;
+                size    = length;
+                return ParseError::Success;
+            }
+
+            buffer.resize(length);
+            std::size_t got = 0;
+            while (got < length) {
+                const auto n = ::read(fd, buffer.data() + got, length - got);
+                if (n > 0) {
+                    got += n;
+                } else if (n == 0 || errno != EINTR) {
+                    break;
+                }
+            }
+            ::close(fd);
+            if (got != length) {
+                buffer.clear();
+                return ParseError::ReadError;
+            }
+            size = length;
+            return ParseError::Success;
+#else
+            static_cast<void>(map);
+            std::ifstream db(path.c_str(), std::ios::binary | std::ios::ate);
+            if (!db) {
+                return ParseError::ReadError;
+            }
+
+            const auto end = db.tellg();
+            if (end <= 0) {
+                return (end == 0) ? ParseError::BadDatabase
+                                  : ParseError::ReadError;
+            }
+
+            db.seekg(0, std::ios::beg);
+            buffer.resize(static_cast<std::size_t>(end));
+            db.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+            if (db.fail()) {
+                buffer.clear();
+                return ParseError::ReadError;
+            }
+            size = buffer.size();
+            return ParseError::Success;
+#endif
+        }
+    };
+
+
+    // null terminated string at 'offset' of a string table, bounded by the
+    // table in case the null byte is missing
+    inline std::string tableString(const char *table, std::size_t length,
+                                   std::size_t offset)
+    {
+        if (offset >= length) {
+            return {};
+        }
+        const auto begin = table + offset;
+        const auto end
+          = static_cast<const char *>(
+            std::memchr(begin, '\0', length - offset));
+        return std::string(begin, end ? end : table + length);
+    }
+
+
+    /*
+        User defined capabilities from the extended section written by
+        ncurses after the standard string table. They are found by name
+        through an open addressing hash table built at load time.
+    */
+    class Extended {
+    public:
+        enum class Type : uint8_t { Boolean, Number, String };
+
+        struct Cap {
+            uint32_t name;  // offset into names
+            uint16_t nameLength;
+            Type type;
+            int32_t value;  // boolean, number or index into programs
+        };
+
+        View<char> names;
+        View<Cap> caps;
+        View<Program> programs;
+        View<Padding> padding;
+
+    private:
+        View<uint16_t> slots;  // index into caps + 1, 0 if empty
+
+        // what the views above are built from, until pack()
+        std::string nameList;
+        std::vector<Cap> capList;
+        std::vector<uint16_t> slotList;
+        std::vector<Program> programList;
+        std::vector<Padding> paddingList;
+
+        static uint32_t hash(const char *s, std::size_t n) noexcept
+        {
+            // FNV-1a
+            uint32_t h = 2166136261u;
+            for (std::size_t i = 0; i < n; ++i) {
+                h = (h ^ static_cast<unsigned char>(s[i])) * 16777619u;
+            }
+            return h;
+        }
+
+    public:
+        void add(const std::string &_name, Type type, int32_t value)
+        {
+            Cap cap;
+            cap.name       = static_cast<uint32_t>(nameList.size());
+            cap.nameLength = static_cast<uint16_t>(_name.size());
+            cap.type       = type;
+            cap.value      = value;
+            nameList.append(_name);
+            capList.push_back(cap);
+        }
+
+        // programs and padding of the string capabilities, filled in by
+        // the caller before buildIndex()
+        void resizeStrings(std::size_t n)
+        {
+            programList.resize(n);
+            paddingList.resize(n);
+        }
+        Program &program(std::size_t i) { return programList[i]; }
+        Padding &pad(std::size_t i) { return paddingList[i]; }
+
+        template <typename F>
+        void eachProgram(F f)
+        {
+            for (auto &prog : programList) {
+                f(prog);
+            }
+        }
+
+        // called once every capability was added
+        void buildIndex()
+        {
+            std::size_t size = 8;
+            while (size < capList.size() * 2) {
+                size *= 2;
+            }
+            slotList.assign(size, 0);
+
+            const auto mask = size - 1;
+            for (std::size_t i = 0; i < capList.size(); ++i) {
+                const auto &cap = capList[i];
+                auto j = hash(&nameList[cap.name], cap.nameLength) & mask;
+                while (slotList[j]) {
+                    j = (j + 1) & mask;
+                }
+                slotList[j] = static_cast<uint16_t>(i + 1);
+            }
+        }
+
+        void pack(Arena &arena)
+        {
+            names    = arena.place(nameList);
+            caps     = arena.place(capList);
+            slots    = arena.place(slotList);
+            programs = arena.place(programList);
+            padding  = arena.place(paddingList);
+        }
+
+        void release() noexcept
+        {
+            std::string().swap(nameList);
+            std::vector<Cap>().swap(capList);
+            std::vector<uint16_t>().swap(slotList);
+            std::vector<Program>().swap(programList);
+            std::vector<Padding>().swap(paddingList);
+        }
+
+        // the hash table find() searches, see Compiled
+        View<uint16_t> index() const noexcept { return slots; }
+
+        // points the views at tables built elsewhere, nothing is added
+        // or packed after
+        void use(View<char> _names, View<Cap> _caps, View<uint16_t> _slots,
+                 View<Program> _programs, View<Padding> _padding) noexcept
+        {
+            names    = _names;
+            caps     = _caps;
+            slots    = _slots;
+            programs = _programs;
+            padding  = _padding;
+        }
+
+        const Cap *find(const char *s, std::size_t n, Type type) const noexcept
+        {
+            if (slots.empty()) {
+                return nullptr;
+            }
+            const auto mask = slots.size() - 1;
+            for (auto j = hash(s, n) & mask; slots[j]; j = (j + 1) & mask) {
+                const auto &cap = caps[slots[j] - 1];
+                if (cap.nameLength == n && cap.type == type
+                    && std::memcmp(names.data() + cap.name, s, n) == 0) {
+                    return &cap;
+                }
+            }
+            return nullptr;
+        }
+    };
+
+
+    /*
+        Every table a decoded Description reads. compiled() returns them
+        as views of a loaded description, and tools/embedTerms.cpp writes
+        them out as constexpr arrays which useCompiled() points an empty
+        description at, without parsing or copying anything.
+    */
+    struct Compiled {
+        View<char> name;
+        uint64_t booleans;  // bit n for tdb::bin n
+        View<int32_t> numbers;
+        View<uint16_t> slots;
+        View<Program> programs;
+        View<Padding> padding;
+        View<Instr> instrs;
+        View<char> chars;
+        View<char> extNames;
+        View<Extended::Cap> extCaps;
+        View<uint16_t> extSlots;
+        View<Program> extPrograms;
+        View<Padding> extPadding;
+    };
+    static_assert(numCapBool <= 64, "booleans fit in Compiled::booleans");
+
+
+    class CodePool;
+
+    // a loaded terminal description, never modified once loaded but for
+    // decoding it lazily, so that it can be shared between TermDb objects
+    // and threads
+    class Description {
+        FileData file;
+        // keeps the bytes alive while parsing when they aren't in 'file'
+        std::shared_ptr<const void> owner;
+
+        // views into the compiled entry, while it is parsed
+        const uint8_t *offsets   = nullptr;
+        const char *table        = nullptr;
+        std::size_t numOffsets   = 0;
+        std::size_t tableLength  = 0;
+
+        // what parsing builds, moved into 'arena' by pack()
+        std::string nameText;
+        std::vector<uint16_t> slotList;
+        std::vector<Program> programList;
+        std::vector<Padding> paddingList;
+        Arena arena;
+
+        // per string capability, index + 1 into programs and padding or 0
+        // for one that is absent, most of them are
+        View<uint16_t> slots;
+        Extended extended;  // see extensions()
+
+        CodePool *pool = nullptr;                   // interning while parsing
+        std::shared_ptr<const CodePool> sharedCode;  // what bytecode views
+
+        // what parse() leaves to decodeValues() and decodeStrings() when
+        // decoding lazily, the input stays alive in 'file' or 'owner'
+        // until the strings are decoded
+        const uint8_t *input    = nullptr;
+        std::size_t inputSize   = 0;
+        std::size_t booleansAt  = 0;
+        std::size_t numBooleans = 0;
+        std::size_t numbersAt   = 0;
+        std::size_t numNumbers  = 0;
+        std::size_t extendedAt  = 0;
+        int numWidth            = 2;
+        bool lazy               = false;
+        mutable std::mutex decoding;
+        std::atomic<bool> valuesDecoded{ false };
+        std::atomic<bool> decoded{ false };
+
+        std::bitset<numCapBool> booleans{};
+        std::array<int32_t, numCapNum> numbers{};
+
+    public:
+        View<char> name;
+        View<Program> programs;  // only capabilities that are present
+        View<Padding> padding;
+        Bytecode bytecode;
+
+        // 'map' allows mapping files of FileData::mapThreshold bytes and
+        // more, which compiled entries never reach, see FileData
+        std::error_code loadDB(const std::string, std::string, bool map = true);
+        // the database file at exactly 'path', nothing else is tried
+        std::error_code loadFile(const std::string &path, bool map = true);
+        // a compiled entry in memory that '_owner' keeps alive until it
+        // is parsed
+        std::error_code loadEntry(std::shared_ptr<const void> _owner,
+                                  const uint8_t *data, std::size_t size);
+
+        // the names section is read while loading, so asking for it
+        // decodes nothing
+        std::string getName() const
+        {
+            if (!isDecoded()) {
+                std::lock_guard<std::mutex> guard(decoding);
+                if (!decoded.load(std::memory_order_relaxed)) {
+                    return nameText;
+                }
+            }
+            return { name.data(), name.size() };
+        }
+
+        bool boolean(tdb::bin b) const
+        {
+            decodeValues();
+            return booleans[static_cast<int>(b)];
+        }
+
+        // -1 if the capability is absent or cancelled
+        int32_t number(tdb::num n) const
+        {
+            decodeValues();
+            return numbers[static_cast<int>(n)];
+        }
+
+        // booleans and numbers are decoded on first use, strings and the
+        // extended section on first use of any of them, rather than
+        // while loading, see Decode
+        void decodeLazily() noexcept { lazy = true; }
+        bool isDecoded() const noexcept
+        {
+            return decoded.load(std::memory_order_acquire);
+        }
+
+        const Extended &extensions() const
+        {
+            decode();
+            return extended;
+        }
+
+        // views of everything this description reads, which live as long
+        // as it does
+        Compiled compiled() const
+        {
+            decode();
+            Compiled c;
+            c.name        = name;
+            c.booleans    = booleans.to_ullong();
+            c.numbers     = View<int32_t>(numbers);
+            c.slots       = slots;
+            c.programs    = programs;
+            c.padding     = padding;
+            c.instrs      = bytecode.instrs;
+            c.chars       = bytecode.chars;
+            c.extNames    = extended.names;
+            c.extCaps     = extended.caps;
+            c.extSlots    = extended.index();
+            c.extPrograms = extended.programs;
+            c.extPadding  = extended.padding;
+            return c;
+        }
+
+        // a decoded description reading 'c', which must outlive it, on
+        // an empty one
+        void useCompiled(const Compiled &c) noexcept
+        {
+            name     = c.name;
+            booleans = std::bitset<numCapBool>(c.booleans);
+            numbers.fill(-1);
+            std::copy(c.numbers.data(),
+                      c.numbers.data()
+                        + std::min(c.numbers.size(), numbers.size()),
+                      numbers.begin());
+            slots           = c.slots;
+            programs        = c.programs;
+            padding         = c.padding;
+            bytecode.instrs = c.instrs;
+            bytecode.chars  = c.chars;
+            extended.use(c.extNames, c.extCaps, c.extSlots, c.extPrograms,
+                         c.extPadding);
+            valuesDecoded.store(true, std::memory_order_release);
+            decoded.store(true, std::memory_order_release);
+        }
+
+        // compiled code goes into 'target' rather than this description,
+        // which can't run anything until usePool()
+        void internInto(CodePool *target) noexcept { pool = target; }
+        // 'shared' was frozen, see loadPooled()
+        void usePool(std::shared_ptr<const CodePool> shared) noexcept;
+
+        // bytes held by this description, none of them outside the object
+        // and its arena once it is decoded, but for a shared CodePool
+        std::size_t memoryFootprint() const noexcept
+        {
+            return sizeof(*this) + (isDecoded() ? arena.size() : inputSize);
+        }
+
+        std::size_t numStrings() const noexcept { return numOffsets; }
+
+        uint16_t stringOffset(std::size_t i) const noexcept
+        {
+            return offsets[2 * i] | (offsets[2 * i + 1] << 8);
+        }
+
+        // raw text of a string capability, which might lack its null byte
+        // in malformed databases
+        std::string rawString(std::size_t i) const
+        {
+            return tableString(table, tableLength, stringOffset(i));
+        }
+
+        // null if the capability is missing or malformed
+        const Program *program(tdb::str _s) const
+        {
+            decode();
+            const size_t s = static_cast<int>(_s);
+            if (s >= slots.size() || !slots[s]) {
+                return nullptr;
+            }
+            const auto &prog = programs[slots[s] - 1];
+            return prog.valid ? &prog : nullptr;
+        }
+
+        // null if the capability has no $<n> padding
+        const Padding *delay(tdb::str _s) const
+        {
+            decode();
+            const size_t s = static_cast<int>(_s);
+            if (s >= slots.size() || !slots[s]) {
+                return nullptr;
+            }
+            const auto &pad = padding[slots[s] - 1];
+            return pad.delay ? &pad : nullptr;
+        }
+
+    private:
+        // decode the booleans and numbers, or the rest, of a lazily
+        // parsed entry once, whichever thread gets there first
+        void decodeValues() const
+        {
+            if (valuesDecoded.load(std::memory_order_acquire)) {
+                return;
+            }
+            std::lock_guard<std::mutex> guard(decoding);
+            if (!valuesDecoded.load(std::memory_order_relaxed)) {
+                const_cast<Description *>(this)->readValues();
+            }
+        }
+
+        void decode() const
+        {
+            if (isDecoded()) {
+                return;
+            }
+            std::lock_guard<std::mutex> guard(decoding);
+            if (!decoded.load(std::memory_order_relaxed)) {
+                const_cast<Description *>(this)->decodeStrings();
+            }
+        }
+
+        void readValues() noexcept;
+        void decodeStrings();
+        void pack();
+        void escape(std::string &) const;
+        void compileString(std::string, Program &, Padding &);
+        void compileStrings();
+        void loadExtended(const uint8_t *, std::size_t, int);
+        std::error_code parse(const uint8_t *, std::size_t);
+    };
+}  // namespace detail
+
+
+namespace detail {
+    /*
+        Compiled capabilities of many descriptions, each distinct program
+        held once. Programs are compared by their instructions and the
+        text of their literals, so identical strings of different
+        terminals meet no matter where they were in their tables.
+    */
+    class CodePool {
+        std::mutex lock;  // guards everything below while interning
+        std::unordered_map<std::string, uint32_t> known;  // key -> begin
+        std::vector<Instr> code;
+        std::string text;
+        Arena arena;
+
+    public:
+        View<Instr> instrs;
+        View<char> chars;
+        std::size_t programs = 0;  // interned, duplicates included
+        std::size_t bytes    = 0;  // their code and text, duplicates included
+
+        // points 'prog' at the pool's copy of it, adding one if needed
+        void intern(const Bytecode &from, Program &prog)
+        {
+            if (!prog.valid || prog.size == 0) {
+                return;
+            }
+            std::string key;
+            std::size_t size = 0;
+            for (auto i = prog.begin; i < prog.begin + prog.size; ++i) {
+                const auto &in = from.code[i];
+                key.append(reinterpret_cast<const char *>(&in),
+                           offsetof(Instr, val));
+                if (in.op == Op::Literal) {
+                    key.append(from.text, in.val, in.len);
+                    size += in.len;
+                } else {
+                    key.append(reinterpret_cast<const char *>(&in.val),
+                               sizeof(in.val));
+                }
+            }
+
+            std::lock_guard<std::mutex> guard(lock);
+            ++programs;
+            bytes += prog.size * sizeof(Instr) + size;
+            const auto found = known.find(key);
+            if (found != known.end()) {
+                prog.begin = found->second;
+                return;
+            }
+            const auto begin = static_cast<uint32_t>(code.size());
+            for (auto i = prog.begin; i < prog.begin + prog.size; ++i) {
+                auto in = from.code[i];
+                if (in.op == Op::Literal) {
+                    text.append(from.text, in.val, in.len);
+                    in.val = static_cast<int32_t>(text.size() - in.len);
+                }
+                code.push_back(in);
+            }
+            known.emplace(std::move(key), begin);
+            prog.begin = begin;
+        }
+
+        // once every description was loaded, nothing can be added after
+        void freeze()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            const auto place = [this]() {
+                instrs = arena.place(code);
+                chars  = arena.place(text);
+            };
+            place();
+            arena.allocate();
+            place();
+            std::vector<Instr>().swap(code);
+            std::string().swap(text);
+            decltype(known)().swap(known);
+        }
+
+        // distinct code and text held
+        std::size_t size() const noexcept { return arena.size(); }
+    };
+}  // namespace detail
+
+
+/*
+    Process wide cache of loaded descriptions keyed by name and path.
+    A description is read from disk only once, even when many threads
+    ask for it at the same time, and lookups of loaded descriptions
+    don't take any lock.
+*/
+class Registry {
+public:
+    using Entry = std::shared_ptr<const detail::Description>;
+
+private:
+    // a loaded description, published once it is complete
+    struct Slot {
+        std::string key;
+        Entry entry;
+        Slot(std::string _key, Entry _entry)
+            : key(std::move(_key)), entry(std::move(_entry))
+        {
+        }
+    };
+
+    // callers wanting the same key while it is loaded wait on this,
+    // it goes away with the load whether it succeeds or not
+    struct Pending {
+        std::mutex loading;
+    };
+
+    // open addressing table of published slots, old tables stay alive
+    // for readers which might still be probing them
+    struct Table {
+        std::unique_ptr<std::atomic<Slot *>[]> slots;
+        std::size_t mask;
+
+        explicit Table(std::size_t size)
+            : slots(new std::atomic<Slot *>[size]), mask(size - 1)
+        {
+            for (std::size_t i = 0; i < size; ++i) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        Slot *find(const std::string &key, std::size_t hash) const noexcept
+        {
+            for (auto i = hash & mask;; i = (i + 1) & mask) {
+                const auto slot = slots[i].load(std::memory_order_acquire);
+                if (!slot || slot->key == key) {
+                    return slot;
+                }
+            }
+        }
+
+        void insert(Slot *slot, std::size_t hash) noexcept
+        {
+            auto i = hash & mask;
+            while (slots[i].load(std::memory_order_relaxed)) {
+                i = (i + 1) & mask;
+            }
+            slots[i].store(slot, std::memory_order_release);
+        }
+    };
+
+    std::atomic<Table *> table;
+    std::mutex lock;  // guards everything below
+    std::vector<std::unique_ptr<Slot>> owned;
+    std::vector<std::unique_ptr<Table>> tables;
+    std::unordered_map<std::string, std::shared_ptr<Pending>> pending;
+
+    // 'lock' is held
+    void publish(std::string key, std::size_t hash, Entry entry)
+    {
+        auto current = table.load(std::memory_order_relaxed);
+        if (current->find(key, hash)) {
+            return;
+        }
+
+        // keep the load factor under one half
+        if ((owned.size() + 1) * 2 > current->mask + 1) {
+            tables.emplace_back(new Table((current->mask + 1) * 2));
+            current = tables.back().get();
+            for (const auto &s : owned) {
+                current->insert(s.get(), std::hash<std::string>{}(s->key));
+            }
+            table.store(current, std::memory_order_release);
+        }
+
+        owned.emplace_back(new Slot(std::move(key), std::move(entry)));
+        current->insert(owned.back().get(), hash);
+    }
+
+public:
+    Registry() : table(nullptr)
+    {
+        tables.emplace_back(new Table(64));
+        table.store(tables.back().get(), std::memory_order_release);
+    }
+    Registry(const Registry &) = delete;
+    Registry &operator=(const Registry &) = delete;
+
+    static Registry &global()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    // returns a null entry and sets 'ec' if the database can't be loaded,
+    // failures are neither cached nor take any room
+    Entry load(const std::string &_name, const std::string &_path,
+               std::error_code &ec)
+    {
+        ec = ParseError::Success;
+        std::string key(_path);
+        key.append(1, '\0').append(_name);
+        const auto hash = std::hash<std::string>{}(key);
+
+        auto published = table.load(std::memory_order_acquire);
+        if (auto found = published->find(key, hash)) {
+            return found->entry;
+        }
+
+        std::shared_ptr<Pending> wait;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto &p = pending[key];
+            if (!p) {
+                p = std::make_shared<Pending>();
+            }
+            wait = p;
+        }
+
+        Entry entry;
+        {
+            std::lock_guard<std::mutex> guard(wait->loading);
+            published = table.load(std::memory_order_acquire);
+            if (auto found = published->find(key, hash)) {
+                return found->entry;
+            }
+            auto db = std::make_shared<detail::Description>();
+            ec      = db->loadDB(_name, _path);
+            if (!ec) {
+                entry = std::move(db);
+            }
+
+            std::lock_guard<std::mutex> publishing(lock);
+            if (entry) {
+                publish(key, hash, entry);
+            }
+            const auto p = pending.find(key);
+            if (p != pending.end() && p->second == wait) {
+                pending.erase(p);
+            }
+        }
+        return entry;
+    }
+
+    Entry load(const std::string &_name, const std::string &_path = DPATH)
+    {
+        std::error_code ec;
+        return load(_name, _path, ec);
+    }
+
+    // number of descriptions loaded
+    std::size_t size()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return owned.size();
+    }
+};
+
+
+// how loadFromMemory() treats the bytes it is given
+enum class Memory {
+    Copy,   // a private copy is parsed
+    Borrow  // parsed in place, the bytes are no longer needed afterwards
+};
+
+// a compiled entry that is already in memory, with the same checks as
+// files get, null with 'ec' set if it doesn't parse
+inline Registry::Entry loadFromMemory(const void *data, std::size_t size,
+                                      std::error_code &ec,
+                                      Memory mode = Memory::Copy)
+{
+    if (!data) {
+        ec = ParseError::BadDatabase;
+        return {};
+    }
+    const auto bytes = static_cast<const uint8_t *>(data);
+    std::shared_ptr<const void> owner;
+    if (mode == Memory::Copy) {
+        auto copy = std::make_shared<std::vector<uint8_t>>(bytes, bytes + size);
+        data      = copy->data();
+        owner     = std::move(copy);
+    }
+
+    auto db = std::make_shared<detail::Description>();
+    ec      = db->loadEntry(std::move(owner),
+                            static_cast<const uint8_t *>(data), size);
+    if (ec) {
+        return {};
+    }
+    return db;
+}
+
+
+// a terminal linked into the program, tables of them are written by
+// tools/embedTerms.cpp
+struct Embedded {
+    const char *name;
+    std::size_t first;  // first row of the table with the same entry
+    const detail::Compiled *entry;
+};
+
+/*
+    Terminals from a table of N Embedded rows sorted by name, where
+    aliases point at the same entry. Nothing is parsed: the first load
+    of an entry points a description kept in the set at its tables,
+    and later loads find it by binary search. Neither constructing the
+    set nor loading allocates. Loaded entries refer to the set and the
+    tables, which must outlive them, embedTerms makes both static.
+*/
+template <std::size_t N>
+class EmbeddedSet {
+    const Embedded *table;
+    mutable std::array<std::once_flag, N> once;
+    mutable std::array<detail::Description, N> descriptions;
+
+public:
+    explicit EmbeddedSet(const Embedded (&_table)[N]) : table(_table) {}
+
+    std::size_t size() const noexcept { return N; }
+
+    bool contains(const std::string &_name) const noexcept
+    {
+        return find(_name) < N;
+    }
+
+    // index of '_name', size() if it isn't in the table
+    std::size_t find(const std::string &_name) const noexcept
+    {
+        const auto end = table + N;
+        const auto row = std::lower_bound(
+          table, end, _name, [](const Embedded &e, const std::string &n) {
+              return n.compare(e.name) > 0;
+          });
+        return (row != end && _name == row->name)
+          ? static_cast<std::size_t>(row - table)
+          : N;
+    }
+
+    Registry::Entry load(const std::string &_name, std::error_code &ec) const
+    {
+        const auto row = find(_name);
+        if (row == N) {
+            ec = ParseError::ReadError;
+            return {};
+        }
+        const auto i = table[row].first;
+        std::call_once(once[i], [this, i]() {
+            descriptions[i].useCompiled(*table[i].entry);
+        });
+        ec = ParseError::Success;
+        // owned by the set, there is no control block to allocate
+        return Registry::Entry(Registry::Entry(), &descriptions[i]);
+    }
+
+    Registry::Entry load(const std::string &_name) const
+    {
+        std::error_code ec;
+        return load(_name, ec);
+    }
+};
+
+
+namespace detail {
+    // a database file found under a terminfo directory
+    struct DirectoryEntry {
+        std::string name;
+        std::string path;
+        uint64_t file;      // device and inode, equal for links to one file
+        uint64_t modified;  // see modifiedTime()
+    };
+
+#ifdef TDB_POSIX
+    inline uint64_t modifiedTime(const struct stat &st) noexcept
+    {
+#if defined(__APPLE__)
+        const auto &t = st.st_mtimespec;
+#elif defined(__linux__)
+        const auto &t = st.st_mtim;
+#else
+        const struct {
+            time_t tv_sec;
+            long tv_nsec;
+        } t{ st.st_mtime, 0 };
+#endif
+        // never 0, which stands for a missing file
+        return static_cast<uint64_t>(t.tv_sec) * 1000000000u + t.tv_nsec + 1;
+    }
+#endif
+
+    // modification time of 'path' in nanoseconds, 0 if it doesn't exist
+    inline uint64_t modifiedTime(const std::string &path) noexcept
+    {
+#ifdef TDB_POSIX
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0) {
+            return modifiedTime(st);
+        }
+#else
+        (void)path;
+#endif
+        return 0;
+    }
+
+    // every file under path/*/, both the letter and the hex layout
+    inline std::vector<DirectoryEntry> listDirectory(std::string path)
+    {
+        std::vector<DirectoryEntry> found;
+#ifdef TDB_POSIX
+        if (!path.empty() && path.back() != '/') {
+            path += '/';
+        }
+        const auto top = ::opendir(path.c_str());
+        if (!top) {
+            return found;
+        }
+        while (const auto group = ::readdir(top)) {
+            if (group->d_name[0] == '.') {
+                continue;
+            }
+            const auto groupPath = path + group->d_name + '/';
+            const auto dir       = ::opendir(groupPath.c_str());
+            if (!dir) {
+                continue;
+            }
+            while (const auto file = ::readdir(dir)) {
+                struct stat st;
+                const auto filePath = groupPath + file->d_name;
+                if (file->d_name[0] == '.'
+                    || ::stat(filePath.c_str(), &st) != 0
+                    || !S_ISREG(st.st_mode)) {
+                    continue;
+                }
+                found.push_back(DirectoryEntry{
+                  file->d_name, filePath,
+                  (static_cast<uint64_t>(st.st_dev) << 32) ^ st.st_ino,
+                  modifiedTime(st) });
+            }
+            ::closedir(dir);
+        }
+        ::closedir(top);
+#endif
+        return found;
+    }
+
+    // sorts a listing of 'root' by name, a file in the letter directory
+    // ahead of one in the hex directory, which is the order loadDB()
+    // tries them in
+    inline void sortListing(std::vector<DirectoryEntry> &listing,
+                            const std::string &root)
+    {
+        const auto at = root.size() + (!root.empty() && root.back() != '/');
+        const auto inLetterDirectory = [at](const DirectoryEntry &e) {
+            return e.path.size() > at + 1 && e.path[at] == e.name[0]
+              && e.path[at + 1] == '/';
+        };
+        std::sort(listing.begin(), listing.end(),
+                  [&inLetterDirectory](const DirectoryEntry &a,
+                                       const DirectoryEntry &b) {
+                      return a.name != b.name
+                        ? a.name < b.name
+                        : inLetterDirectory(a) && !inLetterDirectory(b);
+                  });
+    }
+
+    inline uint32_t get32(const uint8_t *p) noexcept
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16)
+          | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline void put32(std::string &out, uint32_t v)
+    {
+        for (auto i = 0; i < 4; ++i) {
+            out += static_cast<char>((v >> (8 * i)) & 0xFF);
+        }
+    }
+
+    // the names section is "alias|alias|description", the description
+    // is left out
+    inline std::vector<std::string> aliasesOf(const std::string &names)
+    {
+        std::vector<std::string> aliases;
+        std::size_t start = 0, bar;
+        while ((bar = names.find('|', start)) != std::string::npos) {
+            aliases.push_back(names.substr(start, bar - start));
+            start = bar + 1;
+        }
+        return aliases;
+    }
+
+    // reads only the header and names section of a database file
+    inline bool readNames(const std::string &path, std::string &names)
+    {
+        std::ifstream db(path.c_str(), std::ios::binary);
+        uint8_t header[12];
+        if (!db.read(reinterpret_cast<char *>(header), sizeof(header))) {
+            return false;
+        }
+        const auto magic = header[0] | (header[1] << 8);
+        const auto size  = header[2] | (header[3] << 8);
+        if ((magic != 0432 && magic != 01036) || size == 0) {
+            return false;
+        }
+        names.resize(size - 1);
+        return static_cast<bool>(db.read(&names[0], size - 1));
+    }
+}  // namespace detail
+
+
+/*
+    A whole terminfo directory packed into one file, so that opening a
+    terminal is a hash lookup in a single mapping. Every name a file is
+    known by, and the aliases in its names section, lead to one copy of
+    the compiled entry. All numbers are 32 bit little endian -
+      - magic "tdbimage" [0, 8)
+      - version [8], slot count [12], entry count [16], names size [20]
+      - slots of hash, name offset and entry index, 0xffffffff if empty
+      - entries of offset and length into the file
+      - null terminated names
+      - compiled entries, each on an 8 byte boundary
+*/
+class Image {
+    static const char *magic() noexcept { return "tdbimage"; }
+    enum : uint32_t { version = 1, headerSize = 24, noName = 0xFFFFFFFF };
+
+    std::shared_ptr<detail::FileData> file;
+    const uint8_t *slots   = nullptr;
+    const uint8_t *entries = nullptr;
+    const char *names      = nullptr;
+    uint32_t slotCount     = 0;
+    uint32_t entryCount    = 0;
+    uint32_t namesSize     = 0;
+
+    // index of the entry for 'name', -1 if there is none
+    long find(const char *name, std::size_t length) const noexcept
+    {
+        if (!slotCount) {
+            return -1;
+        }
+        const auto hash = detail::nameHash(name, length, 0);
+        for (uint32_t i = hash & (slotCount - 1), n = 0; n < slotCount;
+             i = (i + 1) & (slotCount - 1), ++n) {
+            const auto slot   = slots + 12 * i;
+            const auto offset = detail::get32(slot + 4);
+            if (offset == noName) {
+                return -1;
+            }
+            if (detail::get32(slot) == hash && offset < namesSize
+                && namesSize - offset > length
+                && std::memcmp(names + offset, name, length) == 0
+                && names[offset + length] == '\0') {
+                return detail::get32(slot + 8);
+            }
+        }
+        return -1;
+    }
+
+public:
+    // packs the terminfo directory 'path' into the file 'out', skipping
+    // files that don't parse
+    static std::error_code write(const std::string &path,
+                                 const std::string &out)
+    {
+        struct Entry {
+            uint32_t offset;
+            uint32_t length;
+        };
+        std::vector<Entry> packed;
+        std::unordered_map<uint64_t, uint32_t> byFile;
+        std::unordered_map<std::string, uint32_t> byName;
+        std::string data;
+
+        auto listing = detail::listDirectory(path);
+        if (listing.empty()) {
+            return ParseError::ReadError;
+        }
+        // files first so that aliases never shadow them, the letter
+        // directory wins over the hex one for a name found in both
+        detail::sortListing(listing, path);
+        std::vector<std::pair<std::string, uint32_t>> aliases;
+        for (const auto &found : listing) {
+            if (byName.count(found.name)) {
+                continue;
+            }
+            const auto known = byFile.find(found.file);
+            if (known != byFile.end()) {
+                byName.emplace(found.name, known->second);
+                continue;
+            }
+
+            detail::FileData bytes;
+            detail::Description check;
+            if (bytes.open(found.path, false)
+                || check.loadEntry(nullptr, bytes.data(), bytes.length())) {
+                continue;
+            }
+            const auto index = static_cast<uint32_t>(packed.size());
+            data.append((8 - data.size() % 8) % 8, '\0');
+            packed.push_back(Entry{ static_cast<uint32_t>(data.size()),
+                                     static_cast<uint32_t>(bytes.length()) });
+            data.append(reinterpret_cast<const char *>(bytes.data()),
+                        bytes.length());
+            byFile.emplace(found.file, index);
+            byName.emplace(found.name, index);
+
+            for (auto &alias : detail::aliasesOf(check.getName())) {
+                aliases.emplace_back(std::move(alias), index);
+            }
+        }
+        for (const auto &alias : aliases) {
+            byName.emplace(alias.first, alias.second);
+        }
+        if (packed.empty()) {
+            return ParseError::BadDatabase;
+        }
+
+        uint32_t numSlots = 8;
+        while (numSlots < byName.size() * 2) {
+            numSlots *= 2;
+        }
+        std::vector<std::array<uint32_t, 3>> index(
+          numSlots, std::array<uint32_t, 3>{ { 0, noName, 0 } });
+        std::string pool;
+        for (const auto &key : byName) {
+            const auto hash
+              = detail::nameHash(key.first.data(), key.first.size(), 0);
+            auto i = hash & (numSlots - 1);
+            while (index[i][1] != noName) {
+                i = (i + 1) & (numSlots - 1);
+            }
+            index[i] = { { hash, static_cast<uint32_t>(pool.size()),
+                           key.second } };
+            pool.append(key.first).append(1, '\0');
+        }
+
+        std::string image(magic(), 8);
+        detail::put32(image, version);
+        detail::put32(image, numSlots);
+        detail::put32(image, static_cast<uint32_t>(packed.size()));
+        detail::put32(image, static_cast<uint32_t>(pool.size()));
+        for (const auto &slot : index) {
+            for (const auto v : slot) {
+                detail::put32(image, v);
+            }
+        }
+        const auto dataStart
+          = (image.size() + packed.size() * 8 + pool.size() + 7) / 8 * 8;
+        for (const auto &entry : packed) {
+            detail::put32(image,
+                          static_cast<uint32_t>(dataStart + entry.offset));
+            detail::put32(image, entry.length);
+        }
+        image.append(pool);
+        image.append(dataStart - image.size(), '\0');
+        image.append(data);
+
+        std::ofstream os(out.c_str(), std::ios::binary | std::ios::trunc);
+        os.write(image.data(), image.size());
+        return os ? ParseError::Success : ParseError::ReadError;
+    }
+
+    std::error_code open(const std::string &path, bool map = true)
+    {
+        auto opened = std::make_shared<detail::FileData>();
+        if (const auto ec = opened->open(path, map)) {
+            return ec;
+        }
+
+        const auto bytes = opened->data();
+        const auto size  = opened->length();
+        if (size < headerSize || std::memcmp(bytes, magic(), 8) != 0
+            || detail::get32(bytes + 8) != version) {
+            return ParseError::MagicByteError;
+        }
+        const auto numSlots   = detail::get32(bytes + 12);
+        const auto numEntries = detail::get32(bytes + 16);
+        const auto numNames   = detail::get32(bytes + 20);
+        const auto needed     = headerSize + 12 * uint64_t{ numSlots }
+          + 8 * uint64_t{ numEntries } + numNames;
+        if (numSlots == 0 || (numSlots & (numSlots - 1)) != 0
+            || needed > size) {
+            return ParseError::BadDatabase;
+        }
+
+        file       = std::move(opened);
+        slotCount  = numSlots;
+        entryCount = numEntries;
+        namesSize  = numNames;
+        slots      = bytes + headerSize;
+        entries    = slots + 12 * std::size_t{ numSlots };
+        names      = reinterpret_cast<const char *>(entries)
+          + 8 * std::size_t{ numEntries };
+        return ParseError::Success;
+    }
+
+    bool contains(const std::string &_name) const noexcept
+    {
+        return find(_name.data(), _name.size()) >= 0;
+    }
+
+    // number of distinct compiled entries
+    std::size_t size() const noexcept { return entryCount; }
+
+    // the description stays valid after the image is closed or destroyed
+    Registry::Entry load(const std::string &_name, std::error_code &ec) const
+    {
+        const auto index = find(_name.data(), _name.size());
+        if (index < 0 || static_cast<uint32_t>(index) >= entryCount) {
+            ec = ParseError::ReadError;
+            return {};
+        }
+        const auto at     = entries + 8 * index;
+        const auto offset = detail::get32(at);
+        const auto length = detail::get32(at + 4);
+        if (uint64_t{ offset } + length > file->length()) {
+            ec = ParseError::BadDatabase;
+            return {};
+        }
+
+        auto db = std::make_shared<detail::Description>();
+        ec      = db->loadEntry(file, file->data() + offset, length);
+        if (ec) {
+            return {};
+        }
+        return db;
+    }
+
+    Registry::Entry load(const std::string &_name) const
+    {
+        std::error_code ec;
+        return load(_name, ec);
+    }
+};
+
+
+/*
+    Every name under a terminfo directory mapped to the file holding it,
+    both file names and the aliases of names sections. The tree is
+    listed once, afterwards finding a terminal opens only its own file.
+    refresh() lists it again when a directory was modified, rereading the
+    names of changed files only. Queries may run concurrently, refresh()
+    must not run alongside them.
+*/
+class DirectoryIndex {
+    struct File {
+        std::string path;
+        uint64_t id;
+        uint64_t modified;
+        std::vector<std::string> aliases;
+    };
+    using Stamps = std::vector<std::pair<std::string, uint64_t>>;
+
+    std::string root;
+    std::vector<File> files;
+    std::unordered_map<std::string, uint32_t> byName;
+    std::vector<std::string> sorted;  // every name, for prefix queries
+    Stamps stamps;                    // directories and their mtimes
+
+    Stamps directories() const
+    {
+        Stamps found{ { root, detail::modifiedTime(root) } };
+#ifdef TDB_POSIX
+        if (const auto top = ::opendir(root.c_str())) {
+            while (const auto group = ::readdir(top)) {
+                if (group->d_name[0] != '.') {
+                    const auto dir = root + group->d_name + '/';
+                    found.emplace_back(dir, detail::modifiedTime(dir));
+                }
+            }
+            ::closedir(top);
+        }
+#endif
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+
+    bool filesChanged() const
+    {
+        for (const auto &file : files) {
+            if (detail::modifiedTime(file.path) != file.modified) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    explicit DirectoryIndex(std::string path = DPATH) : root(std::move(path))
+    {
+        if (!root.empty() && root.back() != '/') {
+            root += '/';
+        }
+        refresh();
+    }
+
+    // returns false if nothing changed since the last listing, a file
+    // rewritten in place leaves its directory alone and is found by its
+    // own modification time
+    bool refresh()
+    {
+        auto current = directories();
+        if (current == stamps && !filesChanged()) {
+            return false;
+        }
+
+        auto listing = detail::listDirectory(root);
+        detail::sortListing(listing, root);
+
+        std::unordered_map<uint64_t, uint32_t> previous, byFile;
+        for (uint32_t i = 0; i < files.size(); ++i) {
+            previous.emplace(files[i].id, i);
+        }
+        std::vector<File> found;
+        std::unordered_map<std::string, uint32_t> names;
+        for (const auto &entry : listing) {
+            if (names.count(entry.name)) {
+                continue;
+            }
+            const auto known = byFile.find(entry.file);
+            if (known != byFile.end()) {
+                names.emplace(entry.name, known->second);
+                continue;
+            }
+
+            File file{ entry.path, entry.file, entry.modified, {} };
+            const auto old = previous.find(entry.file);
+            std::string text;
+            if (old != previous.end()
+                && files[old->second].modified == entry.modified) {
+                file.aliases = std::move(files[old->second].aliases);
+            } else if (detail::readNames(entry.path, text)) {
+                file.aliases = detail::aliasesOf(text);
+            }
+            const auto index = static_cast<uint32_t>(found.size());
+            byFile.emplace(entry.file, index);
+            names.emplace(entry.name, index);
+            found.push_back(std::move(file));
+        }
+        // file names first so that aliases never shadow them
+        for (uint32_t i = 0; i < found.size(); ++i) {
+            for (const auto &alias : found[i].aliases) {
+                names.emplace(alias, i);
+            }
+        }
+
+        sorted.clear();
+        sorted.reserve(names.size());
+        for (const auto &n : names) {
+            sorted.push_back(n.first);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        files  = std::move(found);
+        byName = std::move(names);
+        stamps = std::move(current);
+        return true;
+    }
+
+    const std::string &path() const noexcept { return root; }
+
+    // number of names, aliases included
+    std::size_t size() const noexcept { return byName.size(); }
+
+    bool contains(const std::string &_name) const
+    {
+        return byName.count(_name) != 0;
+    }
+
+    // the file holding '_name'
+    nonstd::optional<std::string> find(const std::string &_name) const
+    {
+        const auto found = byName.find(_name);
+        if (found == byName.end()) {
+            return {};
+        }
+        return files[found->second].path;
+    }
+
+    // sorted names starting with 'prefix'
+    std::vector<std::string> withPrefix(const std::string &prefix) const
+    {
+        const auto first
+          = std::lower_bound(sorted.begin(), sorted.end(), prefix);
+        auto last = first;
+        while (last != sorted.end()
+               && last->compare(0, prefix.size(), prefix) == 0) {
+            ++last;
+        }
+        return std::vector<std::string>(first, last);
+    }
+
+    // ReadError without touching the disk for unknown names
+    Registry::Entry load(const std::string &_name, std::error_code &ec) const
+    {
+        const auto found = byName.find(_name);
+        if (found == byName.end()) {
+            ec = ParseError::ReadError;
+            return {};
+        }
+        auto db = std::make_shared<detail::Description>();
+        ec      = db->loadFile(files[found->second].path);
+        if (ec) {
+            return {};
+        }
+        return db;
+    }
+
+    Registry::Entry load(const std::string &_name) const
+    {
+        std::error_code ec;
+        return load(_name, ec);
+    }
+};
+
+
+/*
+    Finds terminals along the search path of ncurses - $TERMINFO,
+    ~/.terminfo, $TERMINFO_DIRS, where an empty element stands for the
+    default directory, then the system directories. Each subdirectory
+    looked into is listed once and kept, so repeated lookups, found or
+    not, don't open anything. A directory is checked for modification at
+    most once per 'recheck', a listing is dropped when its mtime moved.
+*/
+class SearchPath {
+    using Clock = std::chrono::steady_clock;
+
+    // when a directory was last compared with its mtime
+    struct Checked {
+        uint64_t stamp = 0;  // 0 if it doesn't exist
+        bool once      = false;
+        Clock::time_point last;
+    };
+
+    // listing of one letter or hex subdirectory
+    struct Group {
+        Checked checked;
+        std::unordered_set<std::string> names;
+    };
+
+    struct Directory {
+        std::string path;
+        Checked checked;
+        std::unordered_map<std::string, Group> groups;
+    };
+
+    std::vector<Directory> dirs;
+    Clock::duration recheck;
+    std::mutex lock;  // guards dirs
+
+    // true if the mtime of 'path' moved since it was last seen
+    bool modified(const std::string &path, Checked &c,
+                  Clock::time_point now) const
+    {
+        if (c.once && now - c.last < recheck) {
+            return false;
+        }
+        c.once          = true;
+        c.last          = now;
+        const auto seen = c.stamp;
+        c.stamp         = detail::modifiedTime(path);
+        return c.stamp != seen;
+    }
+
+    const Group &group(Directory &d, const std::string &key,
+                       Clock::time_point now) const
+    {
+        const auto path = d.path + key + '/';
+        auto &g         = d.groups[key];
+        // stamped before listing, a change while listing is seen next time
+        if (!modified(path, g.checked, now)) {
+            return g;
+        }
+        g.names.clear();
+#ifdef TDB_POSIX
+        const auto dir = g.checked.stamp ? ::opendir(path.c_str()) : nullptr;
+        if (dir) {
+            while (const auto file = ::readdir(dir)) {
+                if (file->d_name[0] != '.') {
+                    g.names.emplace(file->d_name);
+                }
+            }
+            ::closedir(dir);
+        }
+#endif
+        return g;
+    }
+
+public:
+    explicit SearchPath(
+      std::vector<std::string> directories = environment(),
+      std::chrono::milliseconds _recheck = std::chrono::milliseconds(1000))
+        : recheck(_recheck)
+    {
+        for (auto &path : directories) {
+            if (path.empty()) {
+                continue;
+            }
+            if (path.back() != '/') {
+                path += '/';
+            }
+            const auto seen = std::find_if(
+              dirs.begin(), dirs.end(),
+              [&path](const Directory &d) { return d.path == path; });
+            if (seen == dirs.end()) {
+                dirs.emplace_back();
+                dirs.back().path = std::move(path);
+            }
+        }
+    }
+    SearchPath(const SearchPath &) = delete;
+    SearchPath &operator=(const SearchPath &) = delete;
+
+    static SearchPath &global()
+    {
+        static SearchPath search;
+        return search;
+    }
+
+    // the directories ncurses would search, in order
+    static std::vector<std::string> environment()
+    {
+        std::vector<std::string> found;
+        if (const auto terminfo = std::getenv("TERMINFO")) {
+            found.emplace_back(terminfo);
+        }
+        if (const auto home = std::getenv("HOME")) {
+            found.push_back(std::string(home) + "/.terminfo");
+        }
+        if (const auto list = std::getenv("TERMINFO_DIRS")) {
+            const std::string dirs(list);
+            std::size_t start = 0, end;
+            do {
+                end = std::min(dirs.find(':', start), dirs.size());
+                found.push_back(end == start
+                                  ? std::string(DPATH)
+                                  : dirs.substr(start, end - start));
+                start = end + 1;
+            } while (end < dirs.size());
+        }
+        for (const auto system :
+             { "/etc/terminfo/", "/lib/terminfo/", DPATH }) {
+            found.emplace_back(system);
+        }
+        return found;
+    }
+
+    std::vector<std::string> directories() const
+    {
+        std::vector<std::string> paths;
+        for (const auto &d : dirs) {
+            paths.push_back(d.path);
+        }
+        return paths;
+    }
+
+    // the file holding '_name', from the first directory that has it
+    nonstd::optional<std::string> resolve(const std::string &_name)
+    {
+        if (_name.empty() || _name.find('/') != std::string::npos) {
+            return {};
+        }
+        static const char hexDigits[] = "0123456789abcdef";
+        const auto first = static_cast<unsigned char>(_name[0]);
+        const std::string keys[2]
+          = { _name.substr(0, 1),
+              { hexDigits[first >> 4], hexDigits[first & 0xF] } };
+
+        std::lock_guard<std::mutex> guard(lock);
+#ifdef TDB_POSIX
+        const auto now = Clock::now();
+        for (auto &d : dirs) {
+            // new subdirectories move the mtime of the directory itself
+            if (modified(d.path, d.checked, now)) {
+                d.groups.clear();
+            }
+            if (!d.checked.stamp) {
+                continue;
+            }
+            for (const auto &key : keys) {
+                if (group(d, key, now).names.count(_name)) {
+                    return d.path + key + '/' + _name;
+                }
+            }
+        }
+#else
+        // without directory listings every lookup probes
+        for (const auto &d : dirs) {
+            for (const auto &key : keys) {
+                const auto path = d.path + key + '/' + _name;
+                if (std::ifstream(path.c_str())) {
+                    return path;
+                }
+            }
+        }
+#endif
+        return {};
+    }
+
+    // ReadError if no directory has '_name'
+    Registry::Entry load(const std::string &_name, std::error_code &ec)
+    {
+        const auto path = resolve(_name);
+        if (!path) {
+            ec = ParseError::ReadError;
+            return {};
+        }
+        auto db = std::make_shared<detail::Description>();
+        ec      = db->loadFile(*path);
+        if (ec) {
+            return {};
+        }
+        return db;
+    }
+
+    Registry::Entry load(const std::string &_name)
+    {
+        std::error_code ec;
+        return load(_name, ec);
+    }
+};
+
+
+// when loadAll() decodes the capabilities of an entry
+enum class Decode {
+    Eager,  // while loading, the input isn't kept
+    Lazy    // on first use, until then the bytes of the file are kept
+};
+
+// outcome of loading one terminal with loadAll()
+struct LoadResult {
+    std::string name;
+    Registry::Entry entry;  // null if loading failed
+    std::error_code error;
+};
+
+namespace detail {
+    // load(i) for every index below 'count', over 'threads' threads with
+    // the calling one, the hardware concurrency when 0
+    template <typename F>
+    void forEachIndex(std::size_t count, unsigned threads, F load)
+    {
+        std::atomic<std::size_t> next{ 0 };
+        const auto work = [&]() {
+            for (auto i = next++; i < count; i = next++) {
+                load(i);
+            }
+        };
+
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = static_cast<unsigned>(
+          std::min<std::size_t>(threads, std::max<std::size_t>(count, 1)));
+        std::vector<std::thread> workers;
+        for (auto t = 1u; t < threads; ++t) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto &w : workers) {
+            w.join();
+        }
+    }
+
+#ifdef TDB_IO_URING
+    /*
+        The part of io_uring that reading many small files takes, through
+        the system calls rather than liburing. Requests are queued with
+        push(), at most depth() of them, and wait() submits them all with
+        one system call. valid() is false where the kernel refuses to set
+        up a ring.
+    */
+    class Uring {
+        int fd = -1;
+        io_uring_params params{};
+        void *sqRing     = MAP_FAILED;
+        void *cqRing     = MAP_FAILED;
+        void *entries    = MAP_FAILED;
+        std::size_t sqSize      = 0;
+        std::size_t cqSize      = 0;
+        std::size_t entriesSize = 0;
+        unsigned unsubmitted    = 0;
+
+        static unsigned *field(void *ring, uint32_t offset) noexcept
+        {
+            return reinterpret_cast<unsigned *>(static_cast<char *>(ring)
+                                                + offset);
+        }
+
+        void close() noexcept
+        {
+            if (sqRing != MAP_FAILED) {
+                ::munmap(sqRing, sqSize);
+            }
+            if (cqRing != MAP_FAILED) {
+                ::munmap(cqRing, cqSize);
+            }
+            if (entries != MAP_FAILED) {
+                ::munmap(entries, entriesSize);
+            }
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            sqRing = cqRing = entries = MAP_FAILED;
+            fd                        = -1;
+        }
+
+    public:
+        explicit Uring(unsigned depth)
+        {
+            fd = static_cast<int>(
+              ::syscall(__NR_io_uring_setup, depth, &params));
+            if (fd < 0) {
+                return;
+            }
+            sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqSize
+              = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+            const auto map = [this](std::size_t size, off_t offset) {
+                return ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, fd, offset);
+            };
+            sqRing  = map(sqSize, IORING_OFF_SQ_RING);
+            cqRing  = map(cqSize, IORING_OFF_CQ_RING);
+            entries = map(entriesSize, IORING_OFF_SQES);
+            if (sqRing == MAP_FAILED || cqRing == MAP_FAILED
+                || entries == MAP_FAILED) {
+                close();
+            }
+        }
+        Uring(const Uring &) = delete;
+        Uring &operator=(const Uring &) = delete;
+        ~Uring() { close(); }
+
+        bool valid() const noexcept { return fd >= 0; }
+        unsigned depth() const noexcept { return params.sq_entries; }
+
+        void push(const io_uring_sqe &sqe) noexcept
+        {
+            const auto tail = field(sqRing, params.sq_off.tail);
+            const auto at   = *tail & *field(sqRing, params.sq_off.ring_mask);
+            static_cast<io_uring_sqe *>(entries)[at] = sqe;
+            field(sqRing, params.sq_off.array)[at]   = at;
+            __atomic_store_n(tail, *tail + 1, __ATOMIC_RELEASE);
+            ++unsubmitted;
+        }
+
+        // submits what was pushed and calls done(user_data, res) as
+        // 'count' requests complete, false if the ring failed
+        template <typename F>
+        bool wait(unsigned count, F done)
+        {
+            const auto cqes = reinterpret_cast<io_uring_cqe *>(
+              static_cast<char *>(cqRing) + params.cq_off.cqes);
+            const auto mask = *field(cqRing, params.cq_off.ring_mask);
+            const auto head = field(cqRing, params.cq_off.head);
+            while (count) {
+                const auto r = ::syscall(__NR_io_uring_enter, fd, unsubmitted,
+                                         1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (r < 0 && errno != EINTR && errno != EAGAIN
+                    && errno != EBUSY) {
+                    return false;
+                }
+                unsubmitted -= (r > 0) ? static_cast<unsigned>(r) : 0;
+
+                const auto tail = __atomic_load_n(
+                  field(cqRing, params.cq_off.tail), __ATOMIC_ACQUIRE);
+                auto h = *head;
+                for (; h != tail && count; ++h, --count) {
+                    done(cqes[h & mask].user_data, cqes[h & mask].res);
+                }
+                __atomic_store_n(head, h, __ATOMIC_RELEASE);
+            }
+            return true;
+        }
+    };
+
+    /*
+        The database file of every name, opened, read and closed through
+        io_uring a ring at a time, which takes three system calls per
+        ring rather than three per file. Names that couldn't be read that
+        way, missing or larger than any compiled entry, are left null and
+        the caller loads them as usual.
+    */
+    inline std::vector<std::shared_ptr<std::vector<uint8_t>>>
+    readBatched(const std::vector<std::string> &names, const std::string &path)
+    {
+        // ncurses writes entries of 32 KiB at most
+        enum : std::size_t { depth = 64, capacity = 32 * 1024 };
+        std::vector<std::shared_ptr<std::vector<uint8_t>>> files(names.size());
+        Uring ring(depth);
+        if (!ring.valid() || ring.depth() < depth) {
+            return files;
+        }
+
+        std::vector<std::string> paths(depth);
+        std::vector<int> fds(depth);
+        std::vector<int> sizes(depth);
+        std::vector<uint8_t> buffer(depth * capacity);
+        const auto request = [](uint8_t op, int fd, std::size_t i) {
+            io_uring_sqe sqe;
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode    = op;
+            sqe.fd        = fd;
+            sqe.user_data = i;
+            return sqe;
+        };
+        static const char hexDigits[] = "0123456789abcdef";
+
+        for (std::size_t first = 0; first < names.size(); first += depth) {
+            const auto count
+              = std::min<std::size_t>(depth, names.size() - first);
+            std::fill(fds.begin(), fds.end(), -1);
+            std::fill(sizes.begin(), sizes.end(), -1);
+
+            // the letter directory first, then the hex one, like loadDB()
+            for (const auto hex : { false, true }) {
+                unsigned queued = 0;
+                for (std::size_t i = 0; i < count; ++i) {
+                    const auto &name = names[first + i];
+                    if (name.empty() || fds[i] >= 0) {
+                        continue;
+                    }
+                    const auto c = static_cast<unsigned char>(name[0]);
+                    paths[i]     = path;
+                    if (hex) {
+                        paths[i] += hexDigits[c >> 4];
+                        paths[i] += hexDigits[c & 0xF];
+                    } else {
+                        paths[i] += name[0];
+                    }
+                    paths[i].append(1, '/').append(name);
+
+                    auto sqe = request(IORING_OP_OPENAT, AT_FDCWD, i);
+                    sqe.addr = reinterpret_cast<uintptr_t>(paths[i].data());
+                    sqe.open_flags = O_RDONLY | O_CLOEXEC;
+                    ring.push(sqe);
+                    ++queued;
+                }
+                if (!ring.wait(queued, [&fds](uint64_t i, int res) {
+                        fds[i] = res;
+                    })) {
+                    return files;
+                }
+            }
+
+            unsigned queued = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (fds[i] >= 0) {
+                    auto sqe = request(IORING_OP_READ, fds[i], i);
+                    sqe.addr
+                      = reinterpret_cast<uintptr_t>(&buffer[i * capacity]);
+                    sqe.len  = capacity;
+                    ring.push(sqe);
+                    ++queued;
+                }
+            }
+            const auto read = ring.wait(
+              queued, [&sizes](uint64_t i, int res) { sizes[i] = res; });
+
+            queued = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (fds[i] >= 0) {
+                    ring.push(request(IORING_OP_CLOSE, fds[i], i));
+                    ++queued;
+                }
+            }
+            // kernels without IORING_OP_CLOSE fail it, and so does a ring
+            // that failed reading
+            const auto closed = read
+              && ring.wait(queued, [&fds](uint64_t i, int res) {
+                     if (res >= 0) {
+                         fds[i] = -1;
+                     }
+                 });
+            for (std::size_t i = 0; i < count; ++i) {
+                if (fds[i] >= 0) {
+                    ::close(fds[i]);
+                }
+            }
+            if (!closed) {
+                return files;
+            }
+
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto size = static_cast<std::size_t>(sizes[i]);
+                if (sizes[i] > 0 && size < capacity) {
+                    const auto at    = buffer.begin() + i * capacity;
+                    files[first + i] = std::make_shared<std::vector<uint8_t>>(
+                      at, at + size);
+                }
+            }
+        }
+        return files;
+    }
+#else
+    // nothing is read ahead without TDB_IO_URING
+    inline std::vector<std::shared_ptr<std::vector<uint8_t>>>
+    readBatched(const std::vector<std::string> &, const std::string &)
+    {
+        return {};
+    }
+#endif
+}  // namespace detail
+
+/*
+    Loads many terminals at once over 'threads' threads, the hardware
+    concurrency when 0. Results follow the order of 'names'. Nothing is
+    shared with the Registry. With Decode::Lazy only the header and the
+    names are read up front, which pays off when most entries are only
+    checked for a few capabilities. Built with TDB_IO_URING on
+    Linux the files are read up front in batches by the calling thread,
+    and the threads only parse them.
+*/
+inline std::vector<LoadResult> loadAll(const std::vector<std::string> &names,
+                                       const std::string &path = DPATH,
+                                       unsigned threads = 0,
+                                       Decode decode = Decode::Eager)
+{
+    std::vector<LoadResult> results(names.size());
+    auto files = detail::readBatched(names, path);
+    detail::forEachIndex(names.size(), threads, [&](std::size_t i) {
+        auto db = std::make_shared<detail::Description>();
+        if (decode == Decode::Lazy) {
+            db->decodeLazily();
+        }
+        results[i].name = names[i];
+        if (i < files.size() && files[i]) {
+            const auto &bytes = *files[i];
+            results[i].error
+              = db->loadEntry(std::move(files[i]), bytes.data(), bytes.size());
+        } else {
+            results[i].error = db->loadDB(names[i], path);
+        }
+        if (!results[i].error) {
+            results[i].entry = std::move(db);
+        }
+    });
+    return results;
+}
+
+// what loadPooled() shared
+struct PoolStats {
+    std::size_t programs = 0;  // compiled capabilities loaded
+    std::size_t bytes    = 0;  // their code and text, duplicates included
+    std::size_t pooled   = 0;  // what the pool holds of it
+};
+
+/*
+    Like loadAll(), except that the compiled capabilities of all the
+    terminals go into one pool where each distinct program is held once.
+    Entries only keep their tables and share the pool.
+*/
+inline std::vector<LoadResult> loadPooled(
+  const std::vector<std::string> &names, const std::string &path = DPATH,
+  unsigned threads = 0, PoolStats *stats = nullptr)
+{
+    auto pool = std::make_shared<detail::CodePool>();
+    std::vector<std::shared_ptr<detail::Description>> loaded(names.size());
+    std::vector<LoadResult> results(names.size());
+    detail::forEachIndex(names.size(), threads, [&](std::size_t i) {
+        auto db = std::make_shared<detail::Description>();
+        db->internInto(pool.get());
+        results[i].name  = names[i];
+        results[i].error = db->loadDB(names[i], path);
+        if (!results[i].error) {
+            loaded[i] = std::move(db);
+        }
+    });
+
+    pool->freeze();
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (loaded[i]) {
+            loaded[i]->usePool(pool);
+            results[i].entry = std::move(loaded[i]);
+        }
+    }
+    if (stats) {
+        stats->programs = pool->programs;
+        stats->bytes    = pool->bytes;
+        stats->pooled   = pool->size();
+    }
+    return results;
+}
+
+// every terminal under the directory 'path', sorted by name
+inline std::vector<LoadResult> loadAll(std::string path, unsigned threads = 0,
+                                       Decode decode = Decode::Eager)
+{
+    if (!path.empty() && path.back() != '/') {
+        path += '/';
+    }
+    std::vector<std::string> names;
+    for (const auto &found : detail::listDirectory(path)) {
+        names.push_back(found.name);
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return loadAll(names, path, threads, decode);
+}
+
+
+namespace detail {
+    // one worker running tasks in order, for loads nobody gave an
+    // executor to
+    class IoThread {
+        std::mutex lock;  // guards everything below
+        std::condition_variable wake;
+        std::deque<std::function<void()>> tasks;
+        bool stopping = false;
+        std::thread worker;
+
+        void run()
+        {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.wait(guard,
+                              [this]() { return stopping || !tasks.empty(); });
+                    if (tasks.empty()) {
+                        return;
+                    }
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+    public:
+        IoThread() : worker(&IoThread::run, this) {}
+        IoThread(const IoThread &) = delete;
+        IoThread &operator=(const IoThread &) = delete;
+
+        // finishes what was queued
+        ~IoThread()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_one();
+            worker.join();
+        }
+
+        void operator()(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                tasks.push_back(std::move(task));
+            }
+            wake.notify_one();
+        }
+
+        static IoThread &instance()
+        {
+            // the registry must outlive the tasks run at exit
+            Registry::global();
+            static IoThread io;
+            return io;
+        }
+    };
+}  // namespace detail
+
+/*
+    Loads a terminal off the calling thread, through Registry::global()
+    so that a later Registry::global().load() of the same terminal
+    doesn't wait on the disk. 'executor' is called once with a
+    std::function<void()> to run, 'done' gets the LoadResult on
+    whichever thread ran it and must not throw.
+*/
+template <typename Executor, typename Callback>
+void loadAsync(Executor &&executor, std::string name, std::string path,
+               Callback done)
+{
+    std::forward<Executor>(executor)(std::function<void()>(
+      [name, path, done]() mutable {
+          LoadResult result;
+          result.entry
+            = Registry::global().load(name, path, result.error);
+          result.name = std::move(name);
+          done(std::move(result));
+      }));
+}
+
+// on a worker thread of the library
+template <typename Callback>
+void loadAsync(std::string name, std::string path, Callback done)
+{
+    loadAsync(detail::IoThread::instance(), std::move(name), std::move(path),
+              std::move(done));
+}
+
+inline std::future<LoadResult> loadAsync(std::string name,
+                                         std::string path = DPATH)
+{
+    auto promise = std::make_shared<std::promise<LoadResult>>();
+    auto result  = promise->get_future();
+    loadAsync(std::move(name), std::move(path), [promise](LoadResult r) {
+        promise->set_value(std::move(r));
+    });
+    return result;
+}
+
+
+/*
+    Memoized results of string capabilities called with integer
+    parameters, see TermDb::setCache(). A key holds the capability and
+    the parameters it reads, unread ones are 0. Capabilities keeping
+    static variables %P[A-Z] never reach the cache, dynamic ones only
+    live for one call and don't matter.
+*/
+class ResultCache {
+public:
+    struct Key {
+        int cap   = 0;
+        int arity = 0;  // follows from cap
+        std::array<long, 9> params{};
+
+        bool operator==(const Key &other) const noexcept
+        {
+            return cap == other.cap && params == other.params;
+        }
+        std::size_t hash() const noexcept
+        {
+            std::size_t h = static_cast<std::size_t>(cap);
+            for (const auto p : params) {
+                h = (h ^ static_cast<std::size_t>(p)) * 1099511628211ull;
+            }
+            return h ^ (h >> 29);
+        }
+    };
+
+    virtual ~ResultCache() = default;
+
+    // the result stays valid until the next insert() or clear()
+    virtual const std::string *find(const Key &) = 0;
+    virtual void insert(const Key &, std::string) = 0;
+    virtual void clear() = 0;
+    // an empty cache with the same settings, for copies of a TermDb
+    virtual std::unique_ptr<ResultCache> empty() const = 0;
+};
+
+// keeps the 'capacity' most recently used results
+class LruCache : public ResultCache {
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const noexcept
+        {
+            return key.hash();
+        }
+    };
+    struct Entry {
+        Key key;
+        std::string value;
+    };
+
+    std::size_t capacity;
+    std::list<Entry> entries;  // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+public:
+    explicit LruCache(std::size_t _capacity = 1024)
+        : capacity(std::max<std::size_t>(_capacity, 1))
+    {
+    }
+
+    const std::string *find(const Key &key) override
+    {
+        const auto it = index.find(key);
+        if (it == index.end()) {
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->value;
+    }
+
+    void insert(const Key &key, std::string value) override
+    {
+        const auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->value = std::move(value);
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        if (entries.size() == capacity) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+        entries.push_front(Entry{ key, std::move(value) });
+        index.emplace(key, entries.begin());
+    }
+
+    void clear() override
+    {
+        index.clear();
+        entries.clear();
+    }
+
+    std::unique_ptr<ResultCache> empty() const override
+    {
+        return std::unique_ptr<ResultCache>(new LruCache(capacity));
+    }
+
+    std::size_t size() const noexcept { return entries.size(); }
+};
+
+/*
+    One slot per position of a rows x cols screen, allocated per
+    capability on first use. Capabilities of two parameters are cached
+    for 0 <= p1 < rows and 0 <= p2 < cols, those of one parameter for
+    0 <= p1 < rows * cols, which covers colors too. Anything else is
+    run every time.
+*/
+class DenseCache : public ResultCache {
+    struct Slot {
+        bool filled = false;
+        std::string value;
+    };
+
+    long rows, cols;
+    std::vector<std::vector<Slot>> tables;
+
+    long position(const Key &key) const noexcept
+    {
+        const auto p1 = key.params[0], p2 = key.params[1];
+        if (key.arity > 2 || p1 < 0 || p2 < 0) {
+            return -1;
+        } else if (key.arity == 2) {
+            return (p1 < rows && p2 < cols) ? p1 * cols + p2 : -1;
+        }
+        return (p1 < rows * cols) ? p1 : -1;
+    }
+
+public:
+    DenseCache(int _rows, int _cols)
+        : rows(std::max(_rows, 1)), cols(std::max(_cols, 1)), tables(numCapStr)
+    {
+    }
+
+    const std::string *find(const Key &key) override
+    {
+        const auto pos = position(key);
+        if (pos < 0 || key.cap < 0 || key.cap >= numCapStr
+            || tables[key.cap].empty() || !tables[key.cap][pos].filled) {
+            return nullptr;
+        }
+        return &tables[key.cap][pos].value;
+    }
+
+    void insert(const Key &key, std::string value) override
+    {
+        const auto pos = position(key);
+        if (pos < 0 || key.cap < 0 || key.cap >= numCapStr) {
+            return;
+        }
+        auto &table = tables[key.cap];
+        if (table.empty()) {
+            table.resize(rows * cols);
+        }
+        table[pos].filled = true;
+        table[pos].value  = std::move(value);
+    }
+
+    void clear() override
+    {
+        for (auto &table : tables) {
+            std::vector<Slot>().swap(table);
+        }
+    }
+
+    std::unique_ptr<ResultCache> empty() const override
+    {
+        return std::unique_ptr<ResultCache>(
+          new DenseCache(static_cast<int>(rows), static_cast<int>(cols)));
+    }
+};
+
+struct CacheStats {
+    uint64_t hits   = 0;
+    uint64_t misses = 0;
+};
+
+namespace detail {
+    // the cache of a TermDb, copies start out empty
+    class ResultCacheSlot {
+        mutable std::mutex lock;
+        std::unique_ptr<ResultCache> policy;
+        CacheStats stats;
+
+    public:
+        ResultCacheSlot() = default;
+        ResultCacheSlot(const ResultCacheSlot &other)
+            : policy(other.fresh())
+        {
+        }
+
+        ResultCacheSlot &operator=(const ResultCacheSlot &other)
+        {
+            if (this != &other) {
+                reset(other.fresh());
+            }
+            return *this;
+        }
+
+        explicit operator bool() const noexcept { return policy != nullptr; }
+
+        std::unique_ptr<ResultCache> fresh() const
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return policy ? policy->empty() : nullptr;
+        }
+
+        void reset(std::unique_ptr<ResultCache> _policy)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            policy = std::move(_policy);
+            stats  = CacheStats{};
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (policy) {
+                policy->clear();
+            }
+        }
+
+        CacheStats counters() const
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return stats;
+        }
+
+        // the program runs outside the lock, concurrent misses on the
+        // same key just compute it twice
+        template <typename Out>
+        bool run(int cap, const Program &prog, std::array<long, 9> &params,
+                 const Bytecode &bytecode, Out &out)
+        {
+            ResultCache::Key key;
+            key.cap   = cap;
+            key.arity = prog.arity;
+            std::copy(params.begin(), params.begin() + prog.arity,
+                      key.params.begin());
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (policy) {
+                    if (const auto hit = policy->find(key)) {
+                        ++stats.hits;
+                        out.append(hit->data(), hit->size());
+                        return true;
+                    }
+                    ++stats.misses;
+                }
+            }
+
+            std::string result;
+            if (!bytecode.execute(prog, params, result)) {
+                return false;
+            }
+            out.append(result.data(), result.size());
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (policy) {
+                policy->insert(key, std::move(result));
+            }
+            return true;
+        }
+    };
+}  // namespace detail
+
+
+// the line to a terminal, turns $<n> padding into time or pad characters
+struct Speed {
+    long baud    = 0;  // bits per second
+    int affected = 1;  // lines affected by the capability, for $<n*>
+
+    Speed() = default;
+    Speed(long _baud, int _affected = 1) : baud(_baud), affected(_affected) {}
+};
+
+
+// parameters a string capability reads, %p1 being parameter 0
+struct Signature {
+    int count        = 0;
+    uint16_t strings = 0;
+
+    Signature() = default;
+    Signature(int _count, uint16_t _strings) : count(_count), strings(_strings)
+    {
+    }
+    bool isString(int i) const noexcept { return (strings >> i) & 1; }
+};
+
+
+/*
+    Capabilities with integer parameters interleaved with literal text,
+    written in a single pass by TermDb::append() or TermDb::getInto().
+    A batch doesn't depend on a terminal and can be rendered by several.
+*/
+class Batch {
+    friend class TermDb;
+
+    // text when cap is -1, then offset and length index into 'chars',
+    // otherwise they index into 'values'
+    struct Step {
+        int cap;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::vector<Step> steps;
+    std::vector<long> values;
+    std::string chars;
+
+public:
+    template <typename... Args>
+    Batch &add(tdb::str cap, Args... args)
+    {
+        static_assert(sizeof...(Args) <= 9, "at most 9 parameters");
+        static_assert(detail::AllIntegral<Args...>::value,
+                      "batches take integer parameters");
+        steps.push_back(Step{ static_cast<int>(cap),
+                              static_cast<uint32_t>(values.size()),
+                              sizeof...(Args) });
+        const std::initializer_list<long> list{ static_cast<long>(args)... };
+        values.insert(values.end(), list);
+        return *this;
+    }
+
+    Batch &moveTo(long row, long col)
+    {
+        return add(str::cursor_address, row, col);
+    }
+
+    Batch &text(const char *s, std::size_t n)
+    {
+        if (!steps.empty() && steps.back().cap < 0) {
+            steps.back().length += static_cast<uint32_t>(n);
+            chars.append(s, n);
+            return *this;
+        }
+        steps.push_back(Step{ -1, static_cast<uint32_t>(chars.size()),
+                              static_cast<uint32_t>(n) });
+        chars.append(s, n);
+        return *this;
+    }
+    Batch &text(const std::string &s) { return text(s.data(), s.size()); }
+
+    std::size_t size() const noexcept { return steps.size(); }
+    bool empty() const noexcept { return steps.empty(); }
+
+    void reserve(std::size_t n)
+    {
+        steps.reserve(n);
+        values.reserve(n * 2);
+    }
+
+    // keeps the memory for the next frame
+    void clear() noexcept
+    {
+        steps.clear();
+        values.clear();
+        chars.clear();
+    }
+};
+
+
+class TermDb {
+private:
+    Registry::Entry db;
+    mutable detail::StaticVariables statics;
+    mutable detail::ResultCacheSlot results;
+    bool isValidState = false;
+
+    const detail::Extended::Cap *findExt(const std::string &_name,
+                                         detail::Extended::Type type) const
+      noexcept
+    {
+        return db ? db->extensions().find(_name.data(), _name.size(), type)
+                  : nullptr;
+    }
+
+    // integers are run without building a single param, unless the
+    // capability wants a string or keeps static variables
+    // 'cap' is the tdb::str being run, -1 for extended capabilities
+    template <typename Out, typename... Args>
+    bool run(int cap, const detail::Program &prog, Out &out,
+             Args &&... args) const
+    {
+        static_assert(sizeof...(Args) <= 9, "at most 9 parameters");
+        return dispatch(cap, prog, out,
+                        std::integral_constant<
+                          bool, detail::AllIntegral<Args...>::value>{},
+                        std::forward<Args>(args)...);
+    }
+
+    template <typename Out, typename... Args>
+    bool dispatch(int cap, const detail::Program &prog, Out &out,
+                  std::true_type, Args &&... args) const
+    {
+        if (prog.strings == 0
+            && !(prog.flags & detail::Program::UsesStatic)) {
+            std::array<long, 9> params{ { static_cast<long>(args)... } };
+            return runNumbers(cap, prog, params, out);
+        }
+        return dispatch(cap, prog, out, std::false_type{},
+                        std::forward<Args>(args)...);
+    }
+
+    template <typename Out>
+    bool runNumbers(int cap, const detail::Program &prog,
+                    std::array<long, 9> &params, Out &out) const
+    {
+        if (prog.strings == 0
+            && !(prog.flags & detail::Program::UsesStatic)) {
+            if (cap >= 0 && results) {
+                return results.run(cap, prog, params, db->bytecode, out);
+            }
+            return db->bytecode.execute(prog, params, out);
+        }
+        std::array<param, 9> values;
+        std::copy(params.begin(), params.end(), values.begin());
+        return db->bytecode.execute(prog, values, statics, out);
+    }
+
+    // steps that fail leave nothing behind, returns how many did
+    template <typename Out>
+    std::size_t render(const Batch &batch, Out &out) const
+    {
+        std::size_t failed = 0;
+        std::array<long, 9> params;
+        for (const auto &step : batch.steps) {
+            if (step.cap < 0) {
+                out.append(&batch.chars[step.offset], step.length);
+                continue;
+            }
+            const auto prog = db->program(static_cast<tdb::str>(step.cap));
+            if (!prog) {
+                ++failed;
+                continue;
+            }
+            const auto first = batch.values.begin() + step.offset;
+            std::fill(std::copy(first, first + step.length, params.begin()),
+                      params.end(), 0l);
+            const auto mark = out.size();
+            if (!runNumbers(step.cap, *prog, params, out)) {
+                out.resize(mark);
+                ++failed;
+            }
+        }
+        return failed;
+    }
+
+    template <typename Out, typename... Args>
+    bool dispatch(int, const detail::Program &prog, Out &out,
+                  std::false_type, Args &&... args) const
+    {
+        std::array<param, 9> params{ { detail::toParam(
+          std::forward<Args>(args))... } };
+        return db->bytecode.execute(prog, params, statics, out);
+    }
+
+public:
+    TermDb() = default;
+    TermDb(const std::string &_name, std::string _path = DPATH)
+    {
+        auto loaded = std::make_shared<detail::Description>();
+        const auto error = loaded->loadDB(_name, _path);
+        if (error) {
+            throw error;
+        } else {
+            db           = std::move(loaded);
+            isValidState = true;
+        }
+    }
+
+    // shares an already loaded description, no file is read
+    explicit TermDb(Registry::Entry _db)
+        : db(std::move(_db)), isValidState(db != nullptr)
+    {
+    }
+
+    explicit operator bool() const noexcept { return isValidState; }
+    std::string getName() const { return db ? db->getName() : std::string{}; }
+
+    // this object and the description it shares, which other TermDb
+    // objects might share too
+    std::size_t memoryFootprint() const noexcept
+    {
+        return sizeof(*this) + (db ? db->memoryFootprint() : 0);
+    }
+
+    bool parse(const std::string _name, std::string _path = DPATH)
+    {
+        auto loaded      = std::make_shared<detail::Description>();
+        const auto error = loaded->loadDB(_name, _path);
+        return attach(error ? nullptr : std::move(loaded));
+    }
+
+    // 'data' holds a compiled entry, see loadFromMemory()
+    bool parseFromMemory(const void *data, std::size_t size,
+                         Memory mode = Memory::Copy)
+    {
+        std::error_code ec;
+        return attach(loadFromMemory(data, size, ec, mode));
+    }
+
+    bool attach(Registry::Entry _db)
+    {
+        db = std::move(_db);
+        statics.reset();
+        results.clear();
+        isValidState = db != nullptr;
+        return isValidState;
+    }
+
+    bool get(tdb::bin _b) const noexcept { return db && db->boolean(_b); }
+
+    nonstd::optional<int32_t> get(tdb::num _n) const noexcept
+    {
+        // NP represents 'Not Present' properties, represented by
+        // -1 value in terminfo databases.
+        const auto n = db ? db->number(_n) : -1;
+        if (n < 0) {
+            return {};
+        } else {
+            return n;
+        }
+    }
+
+    std::string get(tdb::str _s) const
+    {
+        // parameterless capabilities are a single literal run
+        const auto prog = db ? db->program(_s) : nullptr;
+        if (prog) {
+            if (prog->size == 0) {
+                return {};
+            }
+            const auto &in = db->bytecode.instrs[prog->begin];
+            if (prog->size == 1 && in.op == detail::Op::Literal) {
+                return std::string(db->bytecode.chars.data() + in.val, in.len);
+            }
+            std::string result;
+            append(_s, result);
+            return result;
+        }
+        return {};
+    }
+
+    // Parameters are integers, strings (std::string or const char *) or
+    // params, missing ones are 0. String capabilities can be requested
+    // concurrently from many threads. Dynamic variables %P[a-z] are local
+    // to each call, static variables %P[A-Z] are shared by all calls on
+    // this object and only capabilities using them take its lock.
+    template <typename... Args>
+    std::string get(tdb::str _s, Args &&... args) const
+    {
+        std::string result;
+        append(_s, result, std::forward<Args>(args)...);
+        return result;
+    }
+
+    // appends the capability to 'out', nothing is appended if it is
+    // missing or malformed
+    template <typename... Args>
+    void append(tdb::str _s, std::string &out, Args &&... args) const
+    {
+        const auto prog = db ? db->program(_s) : nullptr;
+        if (prog) {
+            const auto mark = out.size();
+            if (!run(static_cast<int>(_s), *prog, out,
+                     std::forward<Args>(args)...)) {
+                out.resize(mark);
+            }
+        }
+    }
+
+    // Memoizes capabilities called with integer parameters, e.g. an
+    // LruCache or a DenseCache for the screen size. The cache belongs to
+    // this object, nullptr turns caching off. Like attach(), don't call
+    // it while other threads use the object.
+    void setCache(std::unique_ptr<ResultCache> cache)
+    {
+        results.reset(std::move(cache));
+    }
+
+    CacheStats cacheStats() const { return results.counters(); }
+
+    // writes a whole batch, returns false if any capability was missing
+    // or malformed, those are left out
+    bool append(const Batch &batch, std::string &out) const
+    {
+        if (!db) {
+            return batch.empty();
+        }
+        detail::StringWriter writer(out,
+                                    batch.chars.size() + batch.size() * 12);
+        const auto failed = render(batch, writer);
+        writer.finish();
+        return failed == 0;
+    }
+
+    // like getInto() for a single capability, returns the length of the
+    // whole output
+    std::size_t getInto(const Batch &batch, char *buf, std::size_t cap) const
+    {
+        detail::BufferWriter out(buf, cap);
+        if (db) {
+            render(batch, out);
+        }
+        return out.size();
+    }
+
+    // Microseconds to wait after writing the capability at 'speed', from
+    // its $<n> padding. Like tputs(), padding is skipped on xon_xoff
+    // terminals and below padding_baud_rate, except for $<n/>, bell and
+    // flash_screen. Padding inside conditionals is always counted.
+    long delay(tdb::str _s, const Speed &speed) const noexcept
+    {
+        const auto found = db ? db->delay(_s) : nullptr;
+        if (!found) {
+            return 0;
+        }
+
+        const auto &pad      = *found;
+        const auto threshold = get(num::padding_baud_rate);
+        const auto needed    = (pad.flags & detail::Padding::Mandatory)
+          || _s == str::bell || _s == str::flash_screen
+          || (!get(bin::xon_xoff)
+              && (!threshold || speed.baud >= threshold.value()));
+        if (!needed) {
+            return 0;
+        }
+        const long lines = (pad.flags & detail::Padding::Proportional)
+          ? std::max(speed.affected, 1)
+          : 1;
+        return static_cast<long>(pad.delay) * 100 * lines;
+    }
+
+    // Appends the capability and fills its delay with pad characters,
+    // as many as the line sends meanwhile. Returns the microseconds
+    // still to wait, which is the whole delay for terminals without a
+    // pad character (no_pad_char) and 0 otherwise. Nothing is appended
+    // and 0 returned for missing or malformed capabilities.
+    template <typename... Args>
+    long appendPadded(tdb::str _s, std::string &out, const Speed &speed,
+                      Args &&... args) const
+    {
+        const auto mark = out.size();
+        append(_s, out, std::forward<Args>(args)...);
+        if (out.size() == mark) {
+            return 0;
+        }
+
+        const auto wait = delay(_s, speed);
+        if (wait == 0) {
+            return 0;
+        } else if (get(bin::no_pad_char) || speed.baud <= 0) {
+            return wait;
+        }
+        // 9 bits per character, as ncurses counts them
+        const auto count = static_cast<std::size_t>(
+          (static_cast<double>(wait) * speed.baud) / (9 * 1000000.0));
+        const auto padChar = get(str::pad_char);
+        out.append(count, padChar.empty() ? '\0' : padChar[0]);
+        return 0;
+    }
+
+    // parameters of a string capability as found when it was loaded,
+    // nothing for missing or malformed ones
+    nonstd::optional<Signature> signature(tdb::str _s) const noexcept
+    {
+        const auto prog = db ? db->program(_s) : nullptr;
+        if (!prog) {
+            return {};
+        }
+        return Signature{ prog->arity, prog->strings };
+    }
+
+    // user defined capabilities from the extended section, e.g. "RGB",
+    // "Tc", "Smulx" or "Ss"
+    bool getExtBool(const std::string &_name) const noexcept
+    {
+        const auto cap = findExt(_name, detail::Extended::Type::Boolean);
+        return cap && cap->value;
+    }
+
+    nonstd::optional<int32_t> getExtNum(const std::string &_name) const noexcept
+    {
+        const auto cap = findExt(_name, detail::Extended::Type::Number);
+        if (!cap || cap->value < 0) {
+            return {};
+        } else {
+            return cap->value;
+        }
+    }
+
+    template <typename... Args>
+    std::string getExtStr(const std::string &_name, Args &&... args) const
+    {
+        std::string result;
+        const auto cap = findExt(_name, detail::Extended::Type::String);
+        if (cap && db->extensions().programs[cap->value].valid) {
+            if (!run(-1, db->extensions().programs[cap->value], result,
+                     std::forward<Args>(args)...)) {
+                result.clear();
+            }
+        }
+        return result;
+    }
+
+    // writes at most 'cap' bytes of the capability into 'buf' without
+    // allocating, no null byte is added. Returns the length of the whole
+    // sequence, output was truncated if it is greater than 'cap'. Returns
+    // 0 if the capability is missing or malformed.
+    template <typename... Args>
+    std::size_t getInto(tdb::str _s, char *buf, std::size_t cap,
+                        Args &&... args) const
+    {
+        const auto prog = db ? db->program(_s) : nullptr;
+        if (prog) {
+            detail::BufferWriter out(buf, cap);
+            if (run(static_cast<int>(_s), *prog, out,
+                    std::forward<Args>(args)...)) {
+                return out.size();
+            }
+        }
+        return 0;
+    }
+};
+
+/*
+    Picks the cheapest way of moving the cursor, like ncurses' mvcur().
+    Costs are the bytes written. Capabilities without parameters are
+    measured once, the parm_*_cursor and *_address ones for every count
+    up to the screen size, cursor_address whenever it is considered.
+    Moves assume output post processing is off, so that cursor_down
+    doesn't return the carriage when it is a line feed.
+*/
+class CursorPlanner {
+    static constexpr long unusable = std::numeric_limits<long>::max() / 8;
+
+    // 'count' times 'cap', with 'param' unless it is negative
+    struct Step {
+        tdb::str cap;
+        long param;
+        long count;
+    };
+
+    struct Plan {
+        std::array<Step, 4> steps;
+        int size  = 0;
+        long cost = unusable;
+
+        Plan() = default;
+        explicit Plan(long _cost) : cost(_cost) {}
+        Plan(tdb::str cap, long param, long count, long _cost)
+            : size(1), cost(_cost)
+        {
+            steps[0] = Step{ cap, param, count };
+        }
+
+        Plan operator+(const Plan &other) const
+        {
+            Plan joined(capped(cost + other.cost));
+            joined.steps = steps;
+            joined.size  = size;
+            for (auto i = 0; i < other.size; ++i) {
+                joined.steps[joined.size++] = other.steps[i];
+            }
+            return joined;
+        }
+    };
+
+    enum Counted { Down, Up, Right, Left, Row, Column, numCounted };
+
+    TermDb term;
+    long limit    = 0;
+    long tabWidth = 8;
+    long down = unusable, up = unusable, right = unusable, left = unusable;
+    long carriageReturn = unusable, home = unusable;
+    long tab = unusable, backTab = unusable;
+    std::array<std::vector<long>, numCounted> counted;
+
+    static long capped(long cost)
+    {
+        return (cost < unusable) ? cost : unusable;
+    }
+    static long times(long cost, long n)
+    {
+        return (cost >= unusable || n > unusable / cost) ? unusable : cost * n;
+    }
+
+    static tdb::str countedCap(Counted c)
+    {
+        switch (c) {
+            case Down: return str::parm_down_cursor;
+            case Up: return str::parm_up_cursor;
+            case Right: return str::parm_right_cursor;
+            case Left: return str::parm_left_cursor;
+            case Row: return str::row_address;
+            default: return str::column_address;
+        }
+    }
+
+    template <typename... Args>
+    long measure(tdb::str cap, Args... args) const
+    {
+        const auto n = term.getInto(cap, nullptr, 0, args...);
+        return n ? static_cast<long>(n) : unusable;
+    }
+
+    long costOf(Counted c, long n) const
+    {
+        return (n >= 0 && n < limit) ? counted[c][n]
+                                     : measure(countedCap(c), n);
+    }
+
+    static const Plan &cheaper(const Plan &a, const Plan &b)
+    {
+        return (b.cost < a.cost) ? b : a;
+    }
+
+    // 'n' times a single step capability or once a counted one
+    Plan relative(tdb::str single, long singleCost, Counted c, long n) const
+    {
+        if (n == 0) {
+            return Plan(0);
+        }
+        return cheaper(Plan(single, -1, n, times(singleCost, n)),
+                       Plan(countedCap(c), n, 1, costOf(c, n)));
+    }
+
+    Plan vertical(long from, long to) const
+    {
+        if (from == to) {
+            return Plan(0);
+        }
+        const auto moved = (to > from) ? relative(str::cursor_down, down, Down,
+                                                  to - from)
+                                       : relative(str::cursor_up, up, Up,
+                                                  from - to);
+        return cheaper(moved, Plan(str::row_address, to, 1, costOf(Row, to)));
+    }
+
+    Plan horizontal(long from, long to) const
+    {
+        if (from == to) {
+            return Plan(0);
+        }
+        auto best = cheaper(
+          (to > from) ? relative(str::cursor_right, right, Right, to - from)
+                      : relative(str::cursor_left, left, Left, from - to),
+          Plan(str::column_address, to, 1, costOf(Column, to)));
+
+        // tabs to the stop at or before 'to', then forward
+        const auto stop = to - to % tabWidth;
+        if (to > from && stop > from) {
+            const auto tabs = stop / tabWidth - from / tabWidth;
+            best = cheaper(best, Plan(str::tab, -1, tabs, times(tab, tabs))
+                             + relative(str::cursor_right, right, Right,
+                                        to - stop));
+        } else if (to < from) {
+            const auto tabs = (from - 1) / tabWidth - stop / tabWidth + 1;
+            best = cheaper(best,
+                           Plan(str::back_tab, -1, tabs, times(backTab, tabs))
+                             + relative(str::cursor_right, right, Right,
+                                        to - stop));
+        }
+        return best;
+    }
+
+    // unknown positions are negative, only absolute moves are tried
+    Plan plan(long fromRow, long fromCol, long toRow, long toCol) const
+    {
+        if (toRow < 0 || toCol < 0) {
+            return Plan();
+        }
+        auto best = Plan(str::cursor_address, toRow, 1,
+                         measure(str::cursor_address, toRow, toCol));
+        best = cheaper(best, Plan(str::cursor_home, -1, 1, home)
+                               + vertical(0, toRow) + horizontal(0, toCol));
+        if (fromRow >= 0 && fromCol >= 0) {
+            best = cheaper(best, vertical(fromRow, toRow)
+                                   + horizontal(fromCol, toCol));
+            best = cheaper(best,
+                           Plan(str::carriage_return, -1, 1, carriageReturn)
+                             + vertical(fromRow, toRow) + horizontal(0, toCol));
+        }
+        return best;
+    }
+
+public:
+    explicit CursorPlanner(const TermDb &_term) : term(_term)
+    {
+        down           = measure(str::cursor_down);
+        up             = measure(str::cursor_up);
+        right          = measure(str::cursor_right);
+        left           = measure(str::cursor_left);
+        carriageReturn = measure(str::carriage_return);
+        home           = measure(str::cursor_home);
+        tab            = measure(str::tab);
+        backTab        = measure(str::back_tab);
+        tabWidth = std::max<long>(term.get(num::init_tabs).value_or(8), 1);
+
+        limit = std::max(term.get(num::lines).value_or(0),
+                         term.get(num::columns).value_or(0));
+        limit = std::min<long>(std::max<long>(limit, 256), 4096);
+        for (auto c = 0; c < numCounted; ++c) {
+            counted[c].resize(limit);
+            for (long n = 0; n < limit; ++n) {
+                counted[c][n] = measure(countedCap(static_cast<Counted>(c)), n);
+            }
+        }
+    }
+
+    // bytes written by append() for this move, or -1 if it can't be done
+    long cost(long fromRow, long fromCol, long toRow, long toCol) const
+    {
+        const auto best = plan(fromRow, fromCol, toRow, toCol);
+        return (best.cost < unusable) ? best.cost : -1;
+    }
+
+    // appends the cheapest sequence moving the cursor, nothing if there
+    // is no way of getting there
+    bool append(std::string &out, long fromRow, long fromCol, long toRow,
+                long toCol) const
+    {
+        const auto best = plan(fromRow, fromCol, toRow, toCol);
+        if (best.cost >= unusable) {
+            return false;
+        }
+        for (auto i = 0; i < best.size; ++i) {
+            const auto &step = best.steps[i];
+            for (long n = 0; n < step.count; ++n) {
+                if (step.param < 0) {
+                    term.append(step.cap, out);
+                } else if (step.cap == str::cursor_address) {
+                    term.append(step.cap, out, toRow, toCol);
+                } else {
+                    term.append(step.cap, out, step.param);
+                }
+            }
+        }
+        return true;
+    }
+
+    std::string move(long fromRow, long fromCol, long toRow, long toCol) const
+    {
+        std::string out;
+        append(out, fromRow, fromCol, toRow, toCol);
+        return out;
+    }
+};
+
+
+inline std::error_code detail::Description::loadDB(const std::string _name,
+                                                   std::string _path, bool map)
+{
+
+    const auto hashCharacter = [](unsigned char c) {
+        if (c < 10) {
+            return c + '0';
+        } else {
+            return (c - 10) + 'a';
+        }
+    };
+
+    std::error_code ec = tdb::ParseError::Success;
+    if (_name.empty() || _path.empty()) {
+        ec = tdb::ParseError::ReadError;
+        return ec;
+    }
+
+
+    std::string tryPath = _path;
+    tryPath.append(_name, 0, 1).append(1, '/').append(_name);
+    ec = file.open(tryPath, map);
+    if (ec == tdb::ParseError::ReadError) {
+        // try using hash value
+        char hash[2];
+        unsigned char firstchar = _name[0];
+
+        hash[0] = hashCharacter((firstchar & 0xF0) >> 4);
+        hash[1] = hashCharacter(firstchar & 0x0F);
+        _path.append(&hash[0], 2).append(1, '/').append(_name);
+
+        ec = file.open(_path, map);
+    }
+    if (ec) {
+        return ec;
+    }
+    return parse(file.data(), file.length());
+}
+
+
+inline void detail::Description::usePool(
+  std::shared_ptr<const CodePool> shared) noexcept
+{
+    bytecode.instrs = shared->instrs;
+    bytecode.chars  = shared->chars;
+    sharedCode      = std::move(shared);
+    pool            = nullptr;
+}
+
+
+inline std::error_code detail::Description::loadFile(const std::string &path,
+                                                     bool map)
+{
+    if (const auto ec = file.open(path, map)) {
+        return ec;
+    }
+    return parse(file.data(), file.length());
+}
+
+
+inline std::error_code detail::Description::loadEntry(
+  std::shared_ptr<const void> _owner, const uint8_t *data, std::size_t size)
+{
+    owner = std::move(_owner);
+    return parse(data, size);
+}
+
+
+inline std::error_code detail::Description::parse(const uint8_t *buffer,
+                                                  std::size_t size)
+{
+    std::error_code ec = tdb::ParseError::Success;
+    if (size < 12) {
+        ec = tdb::ParseError::BadDatabase;
+        return ec;
+    }
+
+    // header contains a constant magic number, 01036 marks the extended
+    // number format of ncurses 6.1 which stores numbers in 32 bits
+    const auto magic_byte = buffer[0] | (buffer[1] << 8);
+    if (magic_byte != 0432 && magic_byte != 01036) {
+        ec = tdb::ParseError::MagicByteError;
+        return ec;
+    }
+    numWidth = (magic_byte == 01036) ? 4 : 2;
+
+
+    /* size list contains size/numbers of -
+      - name [0]
+      - booleans [1]
+      - numbers [2]
+      - offsets [3]
+      - stringTable [4]
+    */
+    uint16_t sList[5] = { 0 };
+    for (auto i = 2, j = 0; i < 12; i += 2, ++j) {
+        sList[j] = buffer[i] | (buffer[i + 1] << 8);
+    }
+
+
+    // check for malformed databases, counting the byte which aligns the
+    // number section
+    const std::size_t minBytes = 12 + sList[0] + sList[1]
+      + (sList[0] + sList[1]) % 2 + (sList[2] * numWidth) + (sList[3] * 2)
+      + sList[4];
+    if (size < minBytes) {
+        ec = tdb::ParseError::BadDatabase;
+        return ec;
+    }
+
+    // parse name of terms
+    if (sList[0] > 0) {
+        nameText.assign(buffer + 12, buffer + 11 + sList[0]);
+    }
+
+    // boolean values, read by readValues()
+    int cursor  = 12 + sList[0];
+    booleansAt  = cursor;
+    numBooleans = sList[1];
+    cursor += sList[1];
+
+
+    /*
+        Between the boolean section and the number section, a null
+        byte will be inserted, if necessary, to ensure that the
+        number section begins on an even byte (this is a relic of
+        the PDP-11's word-addressed architecture, originally
+        designed in to avoid IOT traps induced by addressing a
+        word on an odd byte boundary). All short integers are
+        aligned on a short word boundary.
+    */
+    cursor += cursor % 2;
+
+
+    // numbers values, read by readValues()
+    numbersAt  = cursor;
+    numNumbers = sList[2];
+    cursor += sList[2] * numWidth;
+
+
+    // stringOffset values and the string table are used in place
+    offsets    = buffer + cursor;
+    numOffsets = sList[3];
+    cursor += sList[3] * 2;
+
+    table       = reinterpret_cast<const char *>(buffer) + cursor;
+    tableLength = sList[4];
+
+    // the extended section follows on an even byte, if there is one
+    cursor += sList[4];
+    cursor += cursor % 2;
+    input      = buffer;
+    inputSize  = size;
+    extendedAt = cursor;
+    if (!lazy) {
+        readValues();
+        decodeStrings();
+    }
+    return ec;
+}
+
+
+// the parts of parse() which Decode::Lazy puts off until first use
+inline void detail::Description::readValues() noexcept
+{
+    const auto buffer = input;
+    for (std::size_t i = 0; i < numBooleans && i < numCapBool; ++i) {
+        if (buffer[booleansAt + i]) {
+            booleans.set(i);
+        }
+    }
+
+    // missing numbers stay Not Present and cancelled ones (-2) are
+    // treated like missing ones
+    numbers.fill(-1);
+    for (std::size_t j = 0; j < numNumbers && j < numCapNum; ++j) {
+        const auto i = numbersAt + j * numWidth;
+        const auto n = (numWidth == 4)
+          ? static_cast<int32_t>(buffer[i] | (buffer[i + 1] << 8)
+                                 | (buffer[i + 2] << 16)
+                                 | (static_cast<uint32_t>(buffer[i + 3]) << 24))
+          : static_cast<int16_t>(buffer[i] | (buffer[i + 1] << 8));
+        numbers[j] = (n < 0) ? -1 : n;
+    }
+    valuesDecoded.store(true, std::memory_order_release);
+}
+
+inline void detail::Description::decodeStrings()
+{
+    // the input is released once the strings are packed
+    if (!valuesDecoded.load(std::memory_order_relaxed)) {
+        readValues();
+    }
+    compileStrings();
+    if (extendedAt < inputSize) {
+        loadExtended(input + extendedAt, inputSize - extendedAt, numWidth);
+    }
+    if (pool) {
+        for (auto &prog : programList) {
+            pool->intern(bytecode, prog);
+        }
+        extended.eachProgram(
+          [this](Program &prog) { pool->intern(bytecode, prog); });
+        bytecode.release();
+    }
+    pack();
+    decoded.store(true, std::memory_order_release);
+}
+
+
+/*
+    Everything read after loading goes into one exactly sized block, so a
+    description is its own object plus that block, with no slack from
+    growing containers. The input isn't needed any more, a mapped file is
+    unmapped and a borrowed buffer may go away.
+*/
+inline void detail::Description::pack()
+{
+    const auto place = [this]() {
+        name     = arena.place(nameText);
+        slots    = arena.place(slotList);
+        programs = arena.place(programList);
+        padding  = arena.place(paddingList);
+        bytecode.pack(arena);
+        extended.pack(arena);
+    };
+    place();
+    arena.allocate();
+    place();
+
+    std::string().swap(nameText);
+    std::vector<uint16_t>().swap(slotList);
+    std::vector<Program>().swap(programList);
+    std::vector<Padding>().swap(paddingList);
+    bytecode.release();
+    extended.release();
+    file.close();
+    owner.reset();
+    input       = nullptr;
+    offsets     = nullptr;
+    table       = nullptr;
+    numOffsets  = 0;
+    tableLength = 0;
+}
+
+
+/*
+    The extended section has its own header of five short integers -
+      - booleans [0]
+      - numbers [1]
+      - strings [2]
+      - offsets (values and names) [3]
+      - string table size [4]
+    followed by booleans, numbers, value offsets, name offsets and the
+    string table, laid out like the standard sections. Names of all
+    capabilities come after the last value in the string table.
+    A malformed extended section is ignored, standard capabilities stay
+    usable.
+*/
+inline void detail::Description::loadExtended(const uint8_t *buffer,
+                                              std::size_t size, int numWidth)
+{
+    constexpr auto INVALID = 0xFFFE;  // -1 and -2 (cancelled)
+
+    if (size < 10) {
+        return;
+    }
+    uint16_t eList[5] = { 0 };
+    for (auto i = 0, j = 0; i < 10; i += 2, ++j) {
+        eList[j] = buffer[i] | (buffer[i + 1] << 8);
+    }
+    const std::size_t numNames = eList[0] + eList[1] + eList[2];
+    if (eList[3] != eList[2] + numNames) {
+        return;
+    }
+
+    std::size_t cursor = 10 + eList[0];
+    cursor += cursor % 2;
+    const auto numbersAt = cursor;
+    cursor += eList[1] * numWidth;
+    const auto offsetsAt = cursor;
+    cursor += eList[3] * 2;
+    if (cursor + eList[4] > size) {
+        return;
+    }
+    const auto extTable = reinterpret_cast<const char *>(buffer) + cursor;
+    const std::size_t extLength = eList[4];
+
+    const auto offset = [&](std::size_t i) {
+        return static_cast<uint16_t>(buffer[offsetsAt + 2 * i]
+                                     | (buffer[offsetsAt + 2 * i + 1] << 8));
+    };
+
+    // names start after the null byte of the last value
+    std::size_t namesAt = 0;
+    for (auto i = eList[2]; i-- > 0;) {
+        const auto o = offset(i);
+        if (o < INVALID && o < extLength) {
+            namesAt = o + tableString(extTable, extLength, o).size() + 1;
+            break;
+        }
+    }
+    if (namesAt > extLength) {
+        return;
+    }
+    const auto name = [&](std::size_t i) {
+        const auto o = offset(eList[2] + i);
+        return tableString(extTable + namesAt, extLength - namesAt, o);
+    };
+
+    for (std::size_t i = 0; i < eList[0]; ++i) {
+        extended.add(name(i), Extended::Type::Boolean, buffer[10 + i] == 1);
+    }
+    for (std::size_t i = 0; i < eList[1]; ++i) {
+        const auto at = numbersAt + i * numWidth;
+        const auto n  = (numWidth == 4)
+          ? static_cast<int32_t>(buffer[at] | (buffer[at + 1] << 8)
+                                 | (buffer[at + 2] << 16)
+                                 | (static_cast<uint32_t>(buffer[at + 3]) << 24))
+          : static_cast<int16_t>(buffer[at] | (buffer[at + 1] << 8));
+        extended.add(name(eList[0] + i), Extended::Type::Number,
+                     (n < 0) ? -1 : n);
+    }
+
+    extended.resizeStrings(eList[2]);
+    for (std::size_t i = 0; i < eList[2]; ++i) {
+        const auto o = offset(i);
+        if (o < INVALID && o < extLength) {
+            compileString(tableString(extTable, extLength, o),
+                          extended.program(i), extended.pad(i));
+        }
+        extended.add(name(eList[0] + eList[1] + i), Extended::Type::String,
+                     static_cast<int32_t>(i));
+    }
+    extended.buildIndex();
+}
+
+
+namespace detail {
+    // removes $<n>, $<n.m> markers optionally followed by '*' and/or '/'
+    inline Padding stripDelays(std::string &input)
+    {
+        const auto isDigit = [](const char c) {
+            return (c >= '0' && c <= '9');
+        };
+
+        Padding pad;
+        std::size_t out = 0;
+        const auto strLength = input.length();
+
+        for (std::size_t i = 0; i < strLength; ++i) {
+            if (input[i] != '$' || i + 1 >= strLength || input[i + 1] != '<') {
+                input[out++] = input[i];
+                continue;
+            }
+
+            auto j         = i + 2;
+            uint32_t delay = 0;
+            if (j >= strLength || !isDigit(input[j])) {
+                input[out++] = input[i];
+                continue;
+            }
+            for (; j < strLength && isDigit(input[j]); ++j) {
+                delay = (delay * 10) + (input[j] - '0');
+            }
+            delay *= 10;
+            if (j + 1 < strLength && input[j] == '.' && isDigit(input[j + 1])) {
+                delay += input[j + 1] - '0';
+                j += 2;
+            }
+
+            uint8_t flags = 0;
+            for (; j < strLength && (input[j] == '*' || input[j] == '/'); ++j) {
+                const uint8_t flag = (input[j] == '*') ? Padding::Proportional
+                                                       : Padding::Mandatory;
+                if (flags & flag) {
+                    break;
+                }
+                flags |= flag;
+            }
+
+            if (j >= strLength || input[j] != '>') {
+                input[out++] = input[i];
+                continue;
+            }
+            pad.delay += delay;
+            pad.flags |= flags;
+            i = j;
+        }
+        input.resize(out);
+        return pad;
+    }
+}  // namespace detail
+
+
+// escapes and delays are resolved once, the cleaned up text ends up in the
+// literal runs of the compiled programs
+inline void detail::Description::compileStrings()
+{
+    constexpr auto INVALID = std::numeric_limits<uint16_t>::max();
+
+    slotList.assign(numOffsets, 0);
+    for (std::size_t s = 0; s < numOffsets; ++s) {
+        const auto offset = stringOffset(s);
+        if (offset == INVALID || offset >= tableLength) {
+            continue;
+        }
+        Program prog;
+        Padding pad;
+        compileString(rawString(s), prog, pad);
+        if (prog.valid || pad.delay) {
+            programList.push_back(prog);
+            paddingList.push_back(pad);
+            slotList[s] = static_cast<uint16_t>(programList.size());
+        }
+    }
+    while (!slotList.empty() && !slotList.back()) {
+        slotList.pop_back();
+    }
+}
+
+
+inline void detail::Description::compileString(std::string raw, Program &prog,
+                                               Padding &pad)
+{
+    escape(raw);
+    pad = detail::stripDelays(raw);
+    bytecode.compile(raw, prog);
+}
+
+
+inline void detail::Description::escape(std::string &input) const
+{
+    const auto isDigit = [](const char c) { return (c >= '0' && c <= '9'); };
+
+    std::string result;
+    auto strLength   = input.length();
+    bool activeParse = false;
+    errno            = 0;
+
+    for (decltype(strLength) i = 0; i < strLength; ++i) {
+
+        if (!activeParse) {
+            if (input[i] == '\\') {
+                activeParse = true;
+            } else {
+                result += input[i];
+            }
+            continue;
+        }
+
+        switch (input[i]) {
             case '^': result += '^'; break;
             case '\\': result += '\\'; break;
             case ',': result += ','; break;
@@ -866,521 +5423,541 @@ void TermDb::escape(std::string &input) const
 }
 
 
-std::string TermDb::parser(const std::string &s, param p1, param p2, param p3,
-                           param p4, param p5, param p6, param p7, param p8,
-                           param p9) const
-{
-    const auto isDigit    = [](const char c) { return (c >= '0' && c <= '9'); };
-    const auto isFlagChar = [](const char c) {
-        return (c == '-' || c == '+' || c == '#' || c == ' ');
-    };
-    const auto isAlpha = [](const char c) {
-        return ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'));
-    };
-    const auto isPopChar = [](const char c) {
-        return (c == 'd' || c == 'o' || c == 'x' || c == 'X');
-    };
+namespace detail {
+    inline bool Bytecode::compileProgram(const std::string &s, Program &prog)
+    {
+        const auto isDigit = [](const char c) {
+            return (c >= '0' && c <= '9');
+        };
+        const auto isAlpha = [](const char c) {
+            return ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'));
+        };
 
-    class stkOfParams {
-        std::stack<param, std::vector<param>> stk;
+        prog = Program{};
 
-    public:
-        nonstd::optional<long> popNum() noexcept
-        {
-            if (!stk.empty()) {
-                auto &element = stk.top();
-                try {
-                    auto num = mpark::get<long>(element);
-                    stk.pop();
-                    return num;
-                } catch (mpark::bad_variant_access &e) {
-                    return {};
-                }
-            } else {
-                return {};
-            }
-        }
+        // a conditional being compiled, jumps are patched once their
+        // target is known
+        struct Context {
+            int pendingTest = -1;
+            std::vector<int> pendingEnds;
+        };
 
-        nonstd::optional<std::string> popString() noexcept
-        {
-            if (!stk.empty()) {
-                auto &element = stk.top();
-                try {
-                    auto num = mpark::get<std::string>(element);
-                    stk.pop();
-                    return num;
-                } catch (mpark::bad_variant_access &e) {
-                    return {};
-                }
-            } else {
-                return {};
-            }
-        }
+        const auto begin = code.size();
+        std::vector<Context> conList;
+        const auto strLength = s.length();
 
-        nonstd::optional<param> pop() noexcept
-        {
-            if (!stk.empty()) {
-                const auto element = stk.top();
-                stk.pop();
-                return element;
+        const auto emit = [this](Op op, uint8_t arg, uint16_t len,
+                                 int32_t val) {
+            Instr in;
+            in.op  = op;
+            in.arg = arg;
+            in.len = len;
+            in.val = val;
+            code.push_back(in);
+        };
+        // false after any directive, literals never merge across a jump
+        // target
+        bool extendLiteral = false;
+        const auto emitLiteral = [&](const char c) {
+            // extend the previous literal run if it ends where we append
+            if (extendLiteral && code.back().op == Op::Literal
+                && static_cast<std::size_t>(code.back().val + code.back().len)
+                  == text.size()
+                && code.back().len < std::numeric_limits<uint16_t>::max()) {
+                ++code.back().len;
             } else {
-                return {};
+                emit(Op::Literal, 0, 1, static_cast<int32_t>(text.size()));
             }
-        }
-
-        void push(const param _value) noexcept { stk.push(_value); }
-    };
-
-    struct Variables {
-        std::array<param, 26> small;
-        std::array<param, 26> big;
-    };
-
-    struct Context {
-        bool hasThen         = false;
-        bool hasElse         = false;
-        bool ignoreMode      = false;
-        bool scopeIgnoreMode = false;
-        Context(const bool _sim) : scopeIgnoreMode(_sim) {}
-        Context() = delete;
-    };
+            text += c;
+            extendLiteral = true;
+        };
+        const auto here = [&]() {
+            return static_cast<int32_t>(code.size() - begin);
+        };
+        const auto fail = [&]() {
+            code.resize(begin);
+            prog = Program{};
+            return false;
+        };
 
-    std::string result;
-    stkOfParams stk;
-    std::stack<Context, std::vector<Context>> conList;
-    std::ostringstream oss;
-    static Variables V{};
-
-    bool activeParse     = false;
-    bool incorrectString = false;
-    auto strLength       = s.length();
-
-    bool prependBase  = false;
-    bool prependSpace = false;
-    auto precision    = std::string::npos;
-
-    for (decltype(strLength) i = 0; i < strLength; ++i) {
-        // checks if % encoding has started
-        if (!activeParse) {
+        for (std::size_t i = 0; i < strLength; ++i) {
+            if (s[i] != '%') {
+                emitLiteral(s[i]);
+                continue;
+            }
+            if (++i >= strLength) {
+                break;
+            }
             if (s[i] == '%') {
-                activeParse = true;
-            } else {
-                if (conList.empty()
-                    || (!conList.empty() && !conList.top().scopeIgnoreMode
-                        && !conList.top().ignoreMode)) {
-                    result += s[i];
-                }
+                emitLiteral('%');
+                continue;
             }
-            continue;
-        }
 
-        // % encoding has started from here
+            extendLiteral = false;
+            switch (s[i]) {
 
-        // conditional operations
-        bool isConditional = true;
-        switch (s[i]) {
-            case '?':
-                conList.emplace(conList.empty() ? false
-                                                : conList.top().ignoreMode);
-                break;
+                case '?': conList.emplace_back(); break;
 
-            case 't': {
-                if (conList.empty()) {
-                    incorrectString = true;
-                    break;
-                }
-                if (conList.top().scopeIgnoreMode) {
+                case 't':
+                    if (conList.empty() || conList.back().pendingTest != -1) {
+                        return fail();
+                    }
+                    conList.back().pendingTest = here();
+                    emit(Op::JumpIfZero, 0, 0, 0);
                     break;
-                }
 
-                auto p = stk.popNum();
-                if (p) {
-                    conList.top().hasThen    = p.value() != 0;
-                    conList.top().ignoreMode = p.value() == 0;
-                } else {
-                    incorrectString = true;
-                }
-                break;
-            }
+                case 'e':
+                    if (conList.empty()) {
+                        return fail();
+                    }
+                    conList.back().pendingEnds.push_back(here());
+                    emit(Op::Jump, 0, 0, 0);
+                    if (conList.back().pendingTest != -1) {
+                        code[begin + conList.back().pendingTest].val = here();
+                        conList.back().pendingTest = -1;
+                    }
+                    break;
 
-            case 'e':
-                if (conList.empty()) {
-                    incorrectString = true;
+                case ';':
+                    if (conList.empty()) {
+                        return fail();
+                    }
+                    if (conList.back().pendingTest != -1) {
+                        code[begin + conList.back().pendingTest].val = here();
+                    }
+                    for (const auto j : conList.back().pendingEnds) {
+                        code[begin + j].val = here();
+                    }
+                    conList.pop_back();
                     break;
-                }
-                if (conList.top().scopeIgnoreMode) {
+
+                case 'p':
+                    if (++i >= strLength || s[i] < '1' || s[i] > '9') {
+                        return fail();
+                    }
+                    emit(Op::PushParam, static_cast<uint8_t>(s[i] - '1'), 0, 0);
                     break;
-                }
-                conList.top().ignoreMode = conList.top().hasThen;
-                break;
 
-            case ';':
-                if (!conList.empty()) {
-                    conList.pop();
-                } else {
-                    incorrectString = true;
+                case 'P':
+                case 'g': {
+                    const auto op = (s[i] == 'P') ? Op::SetVar : Op::GetVar;
+                    if (++i >= strLength || !isAlpha(s[i])) {
+                        return fail();
+                    }
+                    const auto index = (s[i] >= 'a') ? (s[i] - 'a')
+                                                     : (s[i] - 'A' + 26);
+                    prog.flags |= (index < 26) ? Program::UsesDynamic
+                                               : Program::UsesStatic;
+                    emit(op, static_cast<uint8_t>(index), 0, 0);
+                    break;
                 }
-                break;
-
-            default: isConditional = false; break;
-        }
 
-        if (incorrectString) {
-            break;
-        }
-
-        if (isConditional
-            || (!conList.empty()
-                && (conList.top().scopeIgnoreMode
-                    || conList.top().ignoreMode))) {
-            activeParse = false;
-            continue;
-        }
-
-        // non-condition operations
-        switch (s[i]) {
-            case '%': result += '%'; break;
-
-            case ':': {
-            FLAGS_LABEL:
-                if (++i >= strLength) {
-                    incorrectString = true;
+                case '\'':
+                    if (i + 2 >= strLength || s[i + 2] != '\'') {
+                        return fail();
+                    }
+                    emit(Op::PushConst, 0, 0,
+                         static_cast<unsigned char>(s[i + 1]));
+                    i += 2;
                     break;
-                }
-                switch (s[i]) {
-                    case '-': oss << std::left; break;
-                    case '#': prependBase = true; break;
-                    case '+':
-                    case ' ':
-                        oss << std::showpos;
-                        prependSpace = (s[i] == ' ');
-                        break;
-                    default: incorrectString = true; break;
-                }
 
-                if ((++i) < strLength && s[i] != s[i - 1]) {
-                    if (isDigit(s[i])) {
-                        goto WIDTH_LABEL;
-                    } else if (s[i] == '.') {
-                        goto PRECISION_LABEL;
-                    } else if (isPopChar(s[i])) {
-                        goto POP_LABEL;
-                    } else if (isFlagChar(s[i])) {
-                        goto FLAGS_LABEL;
-                    } else {
-                        incorrectString = true;
+                case '{': {
+                    int32_t num = 0;
+                    if (++i >= strLength || !isDigit(s[i])) {
+                        return fail();
                     }
-                } else {
-                    incorrectString = true;
+                    for (; i < strLength && isDigit(s[i]); ++i) {
+                        num = (num * 10) + (s[i] - '0');
+                    }
+                    if (i >= strLength || s[i] != '}') {
+                        return fail();
+                    }
+                    emit(Op::PushConst, 0, 0, num);
+                    break;
                 }
 
-                break;
-            }
+                case 'l': emit(Op::StrLen, 0, 0, 0); break;
+                case 'i': emit(Op::Increment, 0, 0, 0); break;
+                case '+': emit(Op::Add, 0, 0, 0); break;
+                case '-': emit(Op::Sub, 0, 0, 0); break;
+                case '*': emit(Op::Mul, 0, 0, 0); break;
+                case '/': emit(Op::Div, 0, 0, 0); break;
+                case 'm': emit(Op::Mod, 0, 0, 0); break;
+                case '&': emit(Op::BitAnd, 0, 0, 0); break;
+                case '|': emit(Op::BitOr, 0, 0, 0); break;
+                case '^': emit(Op::BitXor, 0, 0, 0); break;
+                case '=': emit(Op::Eq, 0, 0, 0); break;
+                case '>': emit(Op::Gt, 0, 0, 0); break;
+                case '<': emit(Op::Lt, 0, 0, 0); break;
+                case 'A': emit(Op::And, 0, 0, 0); break;
+                case 'O': emit(Op::Or, 0, 0, 0); break;
+                case '!': emit(Op::Not, 0, 0, 0); break;
+                case '~': emit(Op::Compl, 0, 0, 0); break;
+                case 'c': emit(Op::PutChar, 0, 0, 0); break;
 
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9': {
-            WIDTH_LABEL:
-                int w = s[i] - '0';
-                while ((i + 1) < strLength && isDigit(s[i + 1])) {
-                    ++i;
-                    w = (w * 10) + (s[i] - '0');
-                }
-                oss << std::setw(w);
-
-                if ((i + 1) < strLength) {
-                    if (s[i + 1] == '.') {
-                        ++i;
-                        goto PRECISION_LABEL;
-                    } else if (isPopChar(s[i])) {
-                        ++i;
-                        goto POP_LABEL;
-                    } else {
-                        incorrectString = true;
+                default: {
+                    // %[[:]flags][width[.precision]][doxXs]
+                    uint8_t flags = 0;
+                    bool isString = false;
+                    if (s[i] == ':' || s[i] == '#' || s[i] == ' ') {
+                        if (s[i] == ':') {
+                            ++i;
+                        }
+                        for (; i < strLength; ++i) {
+                            if (s[i] == '-') {
+                                flags |= FmtLeft;
+                            } else if (s[i] == '+') {
+                                flags |= FmtSign;
+                            } else if (s[i] == '#') {
+                                flags |= FmtAlt;
+                            } else if (s[i] == ' ') {
+                                flags |= FmtSpace;
+                            } else {
+                                break;
+                            }
+                        }
                     }
-                } else {
-                    incorrectString = true;
-                }
-                break;
-            }
 
-            case '.': {
-            PRECISION_LABEL:
-                if (++i >= strLength && !isDigit(s[i])) {
-                    incorrectString = true;
-                    break;
-                }
-
-                int p = s[i] - '0';
-                while ((i + 1) < strLength && isDigit(s[i + 1])) {
-                    ++i;
-                    p = (p * 10) + (s[i] - '0');
-                }
-                precision = p;
+                    int width = 0;
+                    if (i < strLength && s[i] == '0') {
+                        flags |= FmtZero;
+                    }
+                    for (; i < strLength && isDigit(s[i]); ++i) {
+                        width = (width * 10) + (s[i] - '0');
+                        if (width > std::numeric_limits<uint16_t>::max()) {
+                            return fail();
+                        }
+                    }
 
-                if ((i + 1) < strLength && isPopChar(s[i])) {
-                    ++i;
-                    goto POP_LABEL;
-                } else {
-                    incorrectString = true;
-                }
-                break;
-            }
+                    int32_t precision = -1;
+                    if (i < strLength && s[i] == '.') {
+                        precision = 0;
+                        for (++i; i < strLength && isDigit(s[i]); ++i) {
+                            precision = (precision * 10) + (s[i] - '0');
+                            if (precision
+                                > std::numeric_limits<uint16_t>::max()) {
+                                return fail();
+                            }
+                        }
+                    }
 
-            case 'd':
-            case 'o':
-            case 'x':
-            case 'X': {
-            POP_LABEL:
-                auto success = stk.popNum();
-                if (success) {
+                    if (i >= strLength) {
+                        return fail();
+                    }
                     switch (s[i]) {
-                        case 'o':
-                            oss << (prependBase ? "0" : "") << std::oct;
-                            break;
-                        case 'x':
-                            oss << (prependBase ? "0x" : "") << std::hex;
-                            break;
-                        case 'X':
-                            oss << (prependBase ? "0X" : "") << std::hex;
-                            break;
+                        case 'd': break;
+                        case 'o': flags |= FmtOct; break;
+                        case 'x': flags |= FmtHex; break;
+                        case 'X': flags |= FmtHex | FmtUpper; break;
+                        case 's': isString = true; break;
+                        default: return fail();
                     }
-                    oss << success.value();
-                    auto str = prependSpace
-                      ? oss.str().replace(oss.str().find('+'), 1, 1, ' ')
-                      : oss.str();
-                    result += str.substr(0, precision);
-                    oss.clear();
-                    oss.str("");
-                    prependBase  = false;
-                    prependSpace = false;
-                    precision    = std::string::npos;
-                } else {
-                    incorrectString = true;
+                    emit(isString ? Op::PutString : Op::PutNumber,
+                         flags, static_cast<uint16_t>(width), precision);
+                    break;
                 }
-                break;
             }
+        }
 
-            case 'c': {
-                auto success = stk.popNum();
-                if (success) {
-                    result += static_cast<char>(success.value());
-                } else {
-                    incorrectString = true;
-                }
-                break;
+        // unterminated conditionals are closed at the end of the string
+        for (const auto &con : conList) {
+            if (con.pendingTest != -1) {
+                code[begin + con.pendingTest].val = here();
             }
-
-            case 's': {
-                auto success = stk.popString();
-                if (success) {
-                    result += success.value();
-                } else {
-                    incorrectString = true;
-                }
-                break;
+            for (const auto j : con.pendingEnds) {
+                code[begin + j].val = here();
             }
+        }
 
-            case 'p': {
-                if (++i >= strLength) {
-                    incorrectString = true;
-                    break;
-                }
+        if (code.size() - begin > std::numeric_limits<uint16_t>::max()) {
+            return fail();
+        }
+        prog.begin = static_cast<uint32_t>(begin);
+        prog.size  = static_cast<uint16_t>(code.size() - begin);
+        prog.valid = true;
+        inferSignature(prog);
+        return true;
+    }
 
-                switch (s[i]) {
-                    case '1': stk.push(p1); break;
-                    case '2': stk.push(p2); break;
-                    case '3': stk.push(p3); break;
-                    case '4': stk.push(p4); break;
-                    case '5': stk.push(p5); break;
-                    case '6': stk.push(p6); break;
-                    case '7': stk.push(p7); break;
-                    case '8': stk.push(p8); break;
-                    case '9': stk.push(p9); break;
-                    default: incorrectString = true; break;
-                }
-                break;
+
+    /*
+        Follows where parameters go on the stack, ignoring jumps. A
+        parameter reaching %s or %l is a string, anything else takes
+        numbers. Values from variables are not followed.
+    */
+    inline void Bytecode::inferSignature(Program &prog) const
+    {
+        std::vector<int> stk;
+        const auto pop = [&stk]() {
+            if (stk.empty()) {
+                return -1;
             }
+            const auto source = stk.back();
+            stk.pop_back();
+            return source;
+        };
+        const auto asString = [&prog](int source) {
+            if (source >= 0) {
+                prog.strings |= static_cast<uint16_t>(1 << source);
+            }
+        };
 
-            case 'l': {
-                auto success = stk.popString();
-                if (success) {
-                    stk.push(success.value().length());
-                } else {
-                    incorrectString = true;
-                }
-                break;
+        const auto first = code.begin() + prog.begin;
+        for (auto ip = first; ip != first + prog.size; ++ip) {
+            switch (ip->op) {
+                case Op::PushParam:
+                    prog.arity = std::max<uint8_t>(prog.arity, ip->arg + 1);
+                    stk.push_back(ip->arg);
+                    break;
+                case Op::PushConst:
+                case Op::GetVar: stk.push_back(-1); break;
+                case Op::StrLen:
+                    asString(pop());
+                    stk.push_back(-1);
+                    break;
+                case Op::PutString: asString(pop()); break;
+                case Op::SetVar:
+                case Op::PutChar:
+                case Op::PutNumber:
+                case Op::JumpIfZero: pop(); break;
+                case Op::Not:
+                case Op::Compl:
+                    pop();
+                    stk.push_back(-1);
+                    break;
+                case Op::Literal:
+                case Op::Increment:
+                case Op::Jump: break;
+                default:
+                    pop();
+                    pop();
+                    stk.push_back(-1);
+                    break;
             }
+        }
+    }
 
-            case 'i': {
-                try {
-                    auto &param1 = mpark::get<long>(p1);
-                    auto &param2 = mpark::get<long>(p2);
-                    ++param1;
-                    ++param2;
-                } catch (mpark::bad_variant_access &e) {
-                    incorrectString = true;
-                }
-                break;
+
+    template <typename Out>
+    void Bytecode::format(const Instr &in, long num, const std::string *str,
+                          Out &out)
+    {
+        // plain %d, by far the most common
+        if (in.op == Op::PutNumber && in.arg == 0 && in.len == 0
+            && in.val < 0) {
+            char digits[24];
+            auto d = digits + sizeof(digits);
+            auto n = (num < 0) ? 0ul - static_cast<unsigned long>(num)
+                               : static_cast<unsigned long>(num);
+            do {
+                *--d = static_cast<char>('0' + n % 10);
+                n /= 10;
+            } while (n);
+            if (num < 0) {
+                *--d = '-';
             }
+            out.append(d, digits + sizeof(digits) - d);
+            return;
+        }
 
-            case '!':
-            case '~': {
-                auto success = stk.popNum();
-                if (success) {
-                    if (s[i] == '!') {
-                        stk.push(!(success.value()));
-                    } else {
-                        stk.push(~(success.value()));
-                    }
-                } else {
-                    incorrectString = true;
-                }
-                break;
+        char fmt[16];
+        auto f = fmt;
+        *f++   = '%';
+        if (in.arg & FmtLeft) *f++ = '-';
+        if (in.arg & FmtSign) *f++ = '+';
+        if (in.arg & FmtAlt) *f++ = '#';
+        if (in.arg & FmtSpace) *f++ = ' ';
+        if (in.arg & FmtZero) *f++ = '0';
+        *f++ = '*';
+        if (in.val >= 0) {
+            *f++ = '.';
+            *f++ = '*';
+        }
+        if (in.op == Op::PutString) {
+            *f++ = 's';
+        } else {
+            *f++ = 'l';
+            *f++ = (in.arg & FmtOct) ? 'o' : (in.arg & FmtUpper)
+                ? 'X'
+                : (in.arg & FmtHex) ? 'x' : 'd';
+        }
+        *f = '\0';
+
+        const auto print = [&](char *buf, std::size_t size) {
+            if (in.op == Op::PutString) {
+                return (in.val >= 0)
+                  ? std::snprintf(buf, size, fmt, int{ in.len }, int{ in.val },
+                                  str->c_str())
+                  : std::snprintf(buf, size, fmt, int{ in.len }, str->c_str());
             }
+            return (in.val >= 0)
+              ? std::snprintf(buf, size, fmt, int{ in.len }, int{ in.val }, num)
+              : std::snprintf(buf, size, fmt, int{ in.len }, num);
+        };
+
+        char buf[64];
+        const auto n = print(buf, sizeof(buf));
+        if (n < 0) {
+            return;
+        } else if (static_cast<std::size_t>(n) < sizeof(buf)) {
+            out.append(buf, n);
+        } else {
+            std::vector<char> large(n + 1);
+            print(large.data(), large.size());
+            out.append(large.data(), n);
+        }
+    }
+
+
+    template <typename Out, typename Value>
+    bool Bytecode::execute(const Program &prog, std::array<Value, 9> &p,
+                           std::array<Value, 26> *statics, Out &out) const
+    {
+        constexpr auto maxStack = 32;
+        std::array<Value, maxStack> stk;
+        std::size_t top  = 0;
+        bool incremented = false;
+        std::array<Value, 26> dynamics;
+        if (prog.flags & Program::UsesDynamic) {
+            dynamics.fill(Value{});
+        }
+
+        const auto isNum = [&](std::size_t depth) {
+            return top >= depth && isNumber(stk[top - depth]);
+        };
+        const auto numAt = [&](std::size_t depth) -> long & {
+            return numberOf(stk[top - depth]);
+        };
+
+        const auto *const first = instrs.data() + prog.begin;
+        const auto *const last  = first + prog.size;
 
-            case '\'': {
-                if (++i >= strLength) {
-                    incorrectString = true;
+        for (auto ip = first; ip < last; ++ip) {
+            const auto &in = *ip;
+            switch (in.op) {
+                case Op::Literal:
+                    out.append(chars.data() + in.val, in.len);
                     break;
-                }
-                char ch = s[i];
-                if (++i >= strLength || s[i] != '\'') {
-                    incorrectString = true;
+
+                case Op::PushParam:
+                    if (top == maxStack) return false;
+                    stk[top++] = p[in.arg];
                     break;
-                }
-                stk.push(ch);
-                ++i;
-                break;
-            }
 
-            case '{': {
-                if (++i >= strLength || !isdigit(s[i])) {
-                    incorrectString = true;
+                case Op::PushConst:
+                    if (top == maxStack) return false;
+                    stk[top++] = static_cast<long>(in.val);
                     break;
-                }
-                int num = s[i] - '0';
-                if (++i >= strLength || !isdigit(s[i])) {
-                    if (s[i] == '}') {
-                        stk.push(num);
+
+                case Op::GetVar:
+                    if (top == maxStack) return false;
+                    stk[top++] = (in.arg < 26) ? dynamics[in.arg]
+                                               : (*statics)[in.arg - 26];
+                    break;
+
+                case Op::SetVar:
+                    if (top == 0) return false;
+                    --top;
+                    if (in.arg < 26) {
+                        dynamics[in.arg] = std::move(stk[top]);
                     } else {
-                        incorrectString = true;
+                        (*statics)[in.arg - 26] = std::move(stk[top]);
                     }
                     break;
-                }
-                num = (num * 10) + (s[i] - '0');
-                if (++i >= strLength || s[i] != '}') {
-                    incorrectString = true;
+
+                case Op::StrLen: {
+                    if (top == 0) return false;
+                    const auto str = stringOf(stk[top - 1]);
+                    if (!str) return false;
+                    stk[top - 1] = static_cast<long>(str->length());
                     break;
                 }
-                stk.push(num);
-                break;
-            }
 
-            case '+':
-            case '-':
-            case '*':
-            case '/':
-            case 'm':
-            case '&':
-            case '|':
-            case '^':
-            case '=':
-            case '>':
-            case '<':
-            case 'A':
-            case 'O': {
-                auto num1 = stk.popNum();
-                if (!num1) {
-                    incorrectString = true;
+                case Op::Increment: {
+                    // like ncurses, repeated %i only count once
+                    if (!isNumber(p[0]) || !isNumber(p[1])) return false;
+                    if (!incremented) {
+                        ++numberOf(p[0]);
+                        ++numberOf(p[1]);
+                        incremented = true;
+                    }
                     break;
                 }
-                auto num2 = stk.popNum();
-                if (!num2) {
-                    incorrectString = true;
+
+                case Op::Not:
+                case Op::Compl:
+                    if (!isNum(1)) return false;
+                    numAt(1) = (in.op == Op::Not) ? !numAt(1) : ~numAt(1);
                     break;
-                }
 
-                switch (s[i]) {
-                    case '+': stk.push(num1.value() + num2.value()); break;
-                    case '-': stk.push(num1.value() - num2.value()); break;
-                    case '*': stk.push(num1.value() * num2.value()); break;
-                    case '/': stk.push(num1.value() / num2.value()); break;
-                    case 'm': stk.push(num1.value() % num2.value()); break;
-                    case '&': stk.push(num1.value() & num2.value()); break;
-                    case '|': stk.push(num1.value() | num2.value()); break;
-                    case '^': stk.push(num1.value() ^ num2.value()); break;
-                    case '=': stk.push(num1.value() == num2.value()); break;
-                    case '>': stk.push(num1.value() > num2.value()); break;
-                    case '<': stk.push(num1.value() < num2.value()); break;
-                    case 'A': stk.push(num1.value() && num2.value()); break;
-                    case 'O': stk.push(num1.value() || num2.value()); break;
-                    default: incorrectString = true; break;
+                case Op::Add:
+                case Op::Sub:
+                case Op::Mul:
+                case Op::Div:
+                case Op::Mod:
+                case Op::BitAnd:
+                case Op::BitOr:
+                case Op::BitXor:
+                case Op::Eq:
+                case Op::Gt:
+                case Op::Lt:
+                case Op::And:
+                case Op::Or: {
+                    if (!isNum(1) || !isNum(2)) return false;
+                    const auto b = numAt(1);
+                    auto &a      = numAt(2);
+                    --top;
+                    switch (in.op) {
+                        case Op::Add: a = a + b; break;
+                        case Op::Sub: a = a - b; break;
+                        case Op::Mul: a = a * b; break;
+                        case Op::Div: a = b ? a / b : 0; break;
+                        case Op::Mod: a = b ? a % b : 0; break;
+                        case Op::BitAnd: a = a & b; break;
+                        case Op::BitOr: a = a | b; break;
+                        case Op::BitXor: a = a ^ b; break;
+                        case Op::Eq: a = a == b; break;
+                        case Op::Gt: a = a > b; break;
+                        case Op::Lt: a = a < b; break;
+                        case Op::And: a = a && b; break;
+                        case Op::Or: a = a || b; break;
+                        default: break;
+                    }
+                    break;
                 }
-                break;
-            }
 
-            case 'P': {
-                if (++i >= strLength || !isAlpha(s[i])) {
-                    incorrectString = true;
+                case Op::PutChar:
+                    if (!isNum(1)) return false;
+                    out.push_back(static_cast<char>(numAt(1)));
+                    --top;
                     break;
-                }
-                if (s[i] >= 'A' && s[i] <= 'Z') {
-                    auto index   = s[i] - 'A';
-                    auto success = stk.pop();
-                    if (success) {
-                        V.big[index] = success.value();
-                    } else {
-                        incorrectString = true;
-                    }
-                } else if (s[i] >= 'a' && s[i] <= 'z') {
-                    auto index   = s[i] - 'a';
-                    auto success = stk.pop();
-                    if (success) {
-                        V.small[index] = success.value();
-                    } else {
-                        incorrectString = true;
-                    }
-                } else {
-                    incorrectString = true;
-                }
-                break;
-            }
 
-            case 'g': {
-                if (++i >= strLength || !isAlpha(s[i])) {
-                    incorrectString = true;
+                case Op::PutNumber:
+                    if (!isNum(1)) return false;
+                    format(in, numAt(1), nullptr, out);
+                    --top;
                     break;
-                }
-                if (s[i] >= 'A' && s[i] <= 'Z') {
-                    const auto index = s[i] - 'A';
-                    stk.push(V.big[index]);
-                } else if (s[i] >= 'a' && s[i] <= 'z') {
-                    const auto index = s[i] - 'a';
-                    stk.push(V.small[index]);
-                } else {
-                    incorrectString = true;
-                }
-                break;
-            }
 
-            default: incorrectString = true; break;
-        }
+                case Op::PutString:
+                    if (top == 0 || isNum(1)) return false;
+                    format(in, 0, stringOf(stk[top - 1]), out);
+                    --top;
+                    break;
 
-        if (incorrectString) {
-            break;
+                case Op::JumpIfZero:
+                    if (!isNum(1)) return false;
+                    if (numAt(1) == 0) {
+                        ip = first + in.val - 1;
+                    }
+                    --top;
+                    break;
+
+                case Op::Jump: ip = first + in.val - 1; break;
+            }
         }
-        activeParse = false;
+        return true;
     }
-    return incorrectString ? "" : result;
-}
+}  // namespace detail
 
 }  // namespace tdb
 
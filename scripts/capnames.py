@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+# Regenerates the capability name tables in include/termdb.hpp from
+# docs/capablities.txt (one "long_name short_name" pair per line, sections
+# for booleans, numbers and strings separated by blank lines).
+#
+# Every table is indexed by the enum value, so the lines must follow the
+# order of tdb::bin, tdb::num and tdb::str. Lookups by name go through a
+# hash-and-displace perfect hash : a key first picks a bucket with seed 0,
+# the bucket's displacement is then the seed that sends it to its own slot.
+# nameHash() below must match detail::nameHash() in the header.
+
+import os
+import sys
+
+root = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+header = os.path.join(root, 'include', 'termdb.hpp')
+begin = '// BEGIN capability names (generated by scripts/capnames.py)\n'
+end = '// END capability names\n'
+
+
+def nameHash(key, seed):
+    h = 2166136261 ^ seed
+    for c in key.encode():
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h ^ (h >> 16)
+
+
+def sections():
+    groups, current = [], []
+    with open(os.path.join(root, 'docs', 'capablities.txt')) as f:
+        for line in f:
+            fields = line.split()
+            if fields:
+                current.append((fields[1], fields[0]))
+            elif current:
+                groups.append(current)
+                current = []
+    if current:
+        groups.append(current)
+    return groups
+
+
+def perfectHash(names):
+    keys = {}
+    for index, (short, long) in enumerate(names):
+        for key in (short, long):
+            if keys.setdefault(key, index) != index:
+                sys.exit('"%s" names two capabilities' % key)
+
+    slotCount = 1
+    while slotCount < len(keys) * 5 // 4:
+        slotCount *= 2
+    bucketCount = max(1, len(keys) // 4)
+
+    buckets = [[] for _ in range(bucketCount)]
+    for key in keys:
+        buckets[nameHash(key, 0) % bucketCount].append(key)
+
+    disp = [0] * bucketCount
+    slots = [0] * slotCount
+    for b in sorted(range(bucketCount), key=lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            continue
+        seed = 1
+        while True:
+            taken = [nameHash(key, seed) % slotCount for key in buckets[b]]
+            if len(set(taken)) == len(taken) and \
+                    all(slots[s] == 0 for s in taken):
+                break
+            seed += 1
+        if seed > 0xFFFF:
+            sys.exit('no displacement fits in 16 bits')
+        disp[b] = seed
+        for key, s in zip(buckets[b], taken):
+            slots[s] = keys[key] + 1
+    return disp, slots
+
+
+def numbers(values, indent):
+    lines, line = [], indent
+    for v in values:
+        item = '%d, ' % v
+        if len(line) + len(item) > 80:
+            lines.append(line.rstrip())
+            line = indent
+        line += item
+    lines.append(line.rstrip().rstrip(','))
+    return '\n'.join(lines)
+
+
+def table(kind, names):
+    disp, slots = perfectHash(names)
+    out = ['    constexpr CapName %sNames[] = {' % kind]
+    out += ['        {"%s", "%s"},' % n for n in names]
+    out[-1] = out[-1].rstrip(',')
+    out.append('    };')
+    out.append('    constexpr uint16_t %sDisp[] = {' % kind)
+    out.append(numbers(disp, '        '))
+    out.append('    };')
+    out.append('    constexpr uint16_t %sSlots[] = {' % kind)
+    out.append(numbers(slots, '        '))
+    out.append('    };')
+    return '\n'.join(out) + '\n'
+
+
+def main():
+    groups = sections()
+    if len(groups) != 3:
+        sys.exit('expected boolean, number and string sections')
+
+    body = 'namespace detail {\n'
+    body += '\n'.join(table(kind, names)
+                      for kind, names in zip(('bin', 'num', 'str'), groups))
+    body += '}  // namespace detail\n'
+
+    with open(header) as f:
+        text = f.read()
+    first, rest = text.split(begin)
+    _, last = rest.split(end)
+    with open(header, 'w') as f:
+        f.write(first + begin + body + end + last)
+
+
+if __name__ == '__main__':
+    main()
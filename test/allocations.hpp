@@ -0,0 +1,74 @@
+#ifndef TDB_TEST_ALLOCATIONS_HPP
+#define TDB_TEST_ALLOCATIONS_HPP
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/*
+    Counts the heap allocations of the whole program by replacing every
+    global allocation function, include it from a single translation
+    unit. The replacements aren't inlined, otherwise GCC sees free()
+    called on what operator new returned and warns at every delete.
+*/
+
+#if defined(__GNUC__)
+#define TDB_NOINLINE __attribute__((noinline))
+#else
+#define TDB_NOINLINE
+#endif
+
+static std::atomic<std::size_t> allocations{ 0 };
+
+TDB_NOINLINE void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+TDB_NOINLINE void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+TDB_NOINLINE void *operator new(std::size_t size,
+                                const std::nothrow_t &) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+TDB_NOINLINE void *operator new[](std::size_t size,
+                                  const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+TDB_NOINLINE void operator delete(void *ptr) noexcept { std::free(ptr); }
+TDB_NOINLINE void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+TDB_NOINLINE void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+TDB_NOINLINE void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+TDB_NOINLINE void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+TDB_NOINLINE void operator delete[](void *ptr,
+                                    const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
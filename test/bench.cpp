@@ -1,7 +1,16 @@
 #include "termdb.hpp"
 #include <iostream>
-#include <sstream>
 #include <chrono>
+#include <iomanip>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stack>
+
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 using namespace tdb;
 using namespace std;
@@ -20,29 +29,1003 @@ struct measure {
 };
 
 
-void runParser(const vector<TermDb> &parsers)
+// resident and shared pages, Linux only
+pair<long, long> memoryPages()
+{
+    long size = 0, resident = 0, shared = 0;
+    ifstream statm("/proc/self/statm");
+    statm >> size >> resident >> shared;
+    return { resident, shared };
+}
+
+void loadCorpus(const vector<string> &nameList)
+{
+    vector<unique_ptr<detail::Description>> loaded;
+    loaded.reserve(nameList.size());
+
+    const auto before = memoryPages();
+    const auto start  = chrono::steady_clock::now();
+    for (auto &term : nameList) {
+        loaded.emplace_back(new detail::Description);
+        loaded.back()->loadDB(term, "mirror/");
+    }
+    const auto elapsed = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+    const auto after = memoryPages();
+
+    const auto page = 4;  // KiB
+    const auto resident = (after.first - before.first) * page;
+    cout << "load:        " << elapsed.count() << " microseconds, resident "
+         << resident << " KiB, private "
+         << ((after.first - after.second) - (before.first - before.second))
+        * page
+         << " KiB\n";
+
+    size_t footprint = 0;
+    for (auto &db : loaded) {
+        footprint += db->memoryFootprint();
+    }
+    cout << "  per entry: resident " << resident * 1024 / loaded.size()
+         << " bytes, footprint " << footprint / loaded.size() << " bytes\n";
+}
+
+// the whole corpus with and without a shared pool of compiled strings
+void loadShared(const vector<string> &nameList, const bool pooled)
+{
+    PoolStats stats;
+    const auto before = memoryPages();
+    const auto start  = chrono::steady_clock::now();
+    const auto loaded = pooled ? loadPooled(nameList, "mirror/", 1, &stats)
+                               : loadAll(nameList, "mirror/", 1);
+    const auto elapsed = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+    const auto after = memoryPages();
+
+    size_t footprint = stats.pooled;
+    for (auto &result : loaded) {
+        footprint += result.entry ? result.entry->memoryFootprint() : 0;
+    }
+    const auto page = 4;  // KiB
+    cout << (pooled ? "load pooled: " : "load alone:  ") << elapsed.count()
+         << " microseconds, resident " << (after.first - before.first) * page
+         << " KiB, footprint " << footprint / 1024 << " KiB\n";
+    if (pooled) {
+        cout << "  " << stats.programs << " programs, " << stats.bytes / 1024
+             << " KiB of code and text pooled into " << stats.pooled / 1024
+             << " KiB, " << double(stats.bytes) / stats.pooled << ":1\n";
+    }
+}
+
+// the whole corpus, of which a terminal picker only checks a few
+// capabilities per entry
+void loadProbed(const vector<string> &nameList, const Decode decode)
+{
+    const auto start  = chrono::steady_clock::now();
+    const auto loaded = loadAll(nameList, "mirror/", 1, decode);
+    const auto load   = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+
+    size_t colors = 0;
+    for (auto &result : loaded) {
+        if (!result.entry) {
+            continue;
+        }
+        TermDb db(result.entry);
+        colors += db.get(num::max_colors).value_or(0) > 8
+          && !db.get(str::clear_screen).empty()
+          && !db.get(str::cursor_address, 0, 0).empty();
+    }
+    const auto elapsed = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+    cout << (decode == Decode::Lazy ? "probe lazy:  " : "probe eager: ")
+         << elapsed.count() << " microseconds, loading " << load.count()
+         << ", " << colors << " color terminals\n";
+}
+
+void loadImage(const vector<string> &nameList)
+{
+    vector<Registry::Entry> loaded;
+    loaded.reserve(nameList.size());
+
+    const auto start = chrono::steady_clock::now();
+    Image image;
+    if (const auto ec = image.open("terminfo.img")) {
+        cerr << "terminfo.img: " << ec.message() << '\n';
+        return;
+    }
+    for (auto &term : nameList) {
+        loaded.emplace_back(image.load(term));
+    }
+    const auto elapsed = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+    cout << "load image:  " << elapsed.count() << " microseconds\n";
+}
+
+void loadIndexed(const vector<string> &nameList)
+{
+    vector<Registry::Entry> loaded;
+    loaded.reserve(nameList.size());
+
+    auto start = chrono::steady_clock::now();
+    DirectoryIndex index("mirror/");
+    const auto built = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+
+    start = chrono::steady_clock::now();
+    index.refresh();
+    const auto refreshed = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+
+    start = chrono::steady_clock::now();
+    for (auto &term : nameList) {
+        loaded.emplace_back(index.load(term));
+    }
+    const auto elapsed = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+    cout << "index " << index.size() << " names: " << built.count()
+         << " microseconds, refresh: " << refreshed.count()
+         << " microseconds\n"
+         << "load indexed: " << elapsed.count() << " microseconds\n";
+}
+
+// a typical path where the first directories don't exist or lack the
+// terminal, resolved by probing every candidate file
+const vector<string> searchDirs{ "home/.terminfo/", "missing/", "terminfo/",
+                                 "mirror/" };
+
+void runProbing(const vector<string> &nameList)
 {
-    ostringstream buffer;
-    for (auto &parser : parsers) {
-        buffer << parser.getName();
-        for (auto i = 0; i < tdb::numCapBool; ++i) {
-            const auto b = parser.get(static_cast<bin>(i));
-            buffer << b;
+    size_t found = 0;
+    for (auto &term : nameList) {
+        const char hex[] = { "0123456789abcdef"[(term[0] >> 4) & 0xF],
+                             "0123456789abcdef"[term[0] & 0xF], '\0' };
+        for (auto &dir : searchDirs) {
+            if (ifstream(dir + term[0] + '/' + term)
+                || ifstream(dir + hex + '/' + term)) {
+                ++found;
+                break;
+            }
         }
-        for (auto i = 0; i < tdb::numCapNum; ++i) {
-            const auto n = parser.get(static_cast<num>(i));
-            buffer << n.value_or(0);
+    }
+    cout << found << " found, ";
+}
+
+void runSearch(SearchPath &search, const vector<string> &nameList)
+{
+    size_t found = 0;
+    for (auto &term : nameList) {
+        found += search.resolve(term) ? 1 : 0;
+    }
+    cout << found << " found, ";
+}
+
+// parses the corpus bytes as they are and then with a few bytes changed
+// in every entry, as a fuzzer would feed them
+void runFuzz(const vector<string> &nameList, const int rounds)
+{
+    vector<string> corpus;
+    size_t total = 0;
+    for (auto &term : nameList) {
+        ifstream in("mirror/" + term.substr(0, 1) + '/' + term, ios::binary);
+        corpus.emplace_back(istreambuf_iterator<char>(in),
+                            istreambuf_iterator<char>());
+        total += corpus.back().size();
+    }
+
+    error_code ec;
+    auto start = chrono::steady_clock::now();
+    for (auto r = 0; r < rounds; ++r) {
+        for (auto &bytes : corpus) {
+            loadFromMemory(bytes.data(), bytes.size(), ec, Memory::Borrow);
         }
-        for (auto i = 0; i < tdb::numCapStr; ++i) {
-            const auto s = parser.get(static_cast<str>(i), 1, 1, 1, 1,
-                                               1, 1, 1, 1, 1);
-            buffer << s;
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << "parse from memory: " << total * rounds / elapsed.count() / 1e6
+         << " MB/s, " << corpus.size() * rounds / elapsed.count()
+         << " entries/s\n";
+
+    uint32_t seed       = 1;
+    size_t accepted     = 0;
+    const auto pristine = corpus;
+    start               = chrono::steady_clock::now();
+    for (auto r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            auto &bytes = corpus[i];
+            for (auto k = 0; k < 4; ++k) {
+                seed = seed * 1664525 + 1013904223;
+                bytes[(seed >> 8) % bytes.size()] = static_cast<char>(seed);
+            }
+            accepted += loadFromMemory(bytes.data(), bytes.size(), ec,
+                                       Memory::Borrow)
+              != nullptr;
+            bytes = pristine[i];
         }
     }
+    elapsed = chrono::steady_clock::now() - start;
+    cout << "parse mutated:     " << corpus.size() * rounds / elapsed.count()
+         << " entries/s, " << accepted << " accepted\n";
+}
+
+// runs in a child process where available, so that memory usage isn't
+// skewed by what earlier runs left in the heap
+template <typename F, typename... Args>
+void isolated(F &&func, Args &&... args)
+{
+#ifdef __linux__
+    cout.flush();
+    const auto pid = fork();
+    if (pid == 0) {
+        func(forward<Args>(args)...);
+        cout.flush();
+        _exit(0);
+    } else if (pid > 0) {
+        waitpid(pid, nullptr, 0);
+        return;
+    }
+#endif
+    func(forward<Args>(args)...);
+}
+
+/*
+    get() of the original TermDb, frozen here as the baseline the
+    compiled programs are measured against. Every call escapes the raw
+    text, strips delays with a regex and interprets the result.
+*/
+namespace reference {
+    // https://regex101.com/r/GwGLfk/1
+    constexpr auto delayStr = R"(\$<\d+(\.\d{1})?((\/?\*?)|(\*?\/?))>)";
+
+    void escape(std::string &input)
+    {
+        const auto isDigit = [](const char c) { return (c >= '0' && c <= '9'); };
+
+        std::string result;
+        auto strLength   = input.length();
+        bool activeParse = false;
+        errno            = 0;
+
+        for (decltype(strLength) i = 0; i < strLength; ++i) {
+
+            if (!activeParse) {
+                if (input[i] == '\\') {
+                    activeParse = true;
+                } else {
+                    result += input[i];
+                }
+                continue;
+            }
+
+            switch (input[i]) {
+                case '^': result += '^'; break;
+                case '\\': result += '\\'; break;
+                case ',': result += ','; break;
+                case ':': result += ':'; break;
+                case '0':
+                    if ((i + 1) == strLength || !isDigit(input[i + 1])) {
+                        result += "\\200";
+                        break;
+                    }
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                    if ((i + 2) < strLength && isDigit(input[i + 1])
+                        && isDigit(input[i + 2])) {
+                        char arr[4];
+                        arr[0] = input[i];
+                        arr[1] = input[i + 1];
+                        arr[2] = input[i + 2];
+                        arr[3] = 0;
+                        i += 2;
+                        const auto decNum = strtol(arr, NULL, 8);
+                        if (errno != 0) {
+                            result.clear();
+                        } else {
+                            result += std::to_string(decNum);
+                        }
+                        break;
+                    }
+                default: result += input[i]; break;
+            }
+            activeParse = false;
+        }
+        std::swap(result, input);
+    }
+
+
+    std::string parser(const std::string &s, param p1, param p2, param p3,
+                       param p4, param p5, param p6, param p7, param p8, param p9)
+    {
+        const auto isDigit    = [](const char c) { return (c >= '0' && c <= '9'); };
+        const auto isFlagChar = [](const char c) {
+            return (c == '-' || c == '+' || c == '#' || c == ' ');
+        };
+        const auto isAlpha = [](const char c) {
+            return ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'));
+        };
+        const auto isPopChar = [](const char c) {
+            return (c == 'd' || c == 'o' || c == 'x' || c == 'X');
+        };
+
+        class stkOfParams {
+            std::stack<param, std::vector<param>> stk;
+
+        public:
+            nonstd::optional<long> popNum() noexcept
+            {
+                if (!stk.empty()) {
+                    auto &element = stk.top();
+                    try {
+                        auto num = mpark::get<long>(element);
+                        stk.pop();
+                        return num;
+                    } catch (mpark::bad_variant_access &e) {
+                        return {};
+                    }
+                } else {
+                    return {};
+                }
+            }
+
+            nonstd::optional<std::string> popString() noexcept
+            {
+                if (!stk.empty()) {
+                    auto &element = stk.top();
+                    try {
+                        auto num = mpark::get<std::string>(element);
+                        stk.pop();
+                        return num;
+                    } catch (mpark::bad_variant_access &e) {
+                        return {};
+                    }
+                } else {
+                    return {};
+                }
+            }
+
+            nonstd::optional<param> pop() noexcept
+            {
+                if (!stk.empty()) {
+                    const auto element = stk.top();
+                    stk.pop();
+                    return element;
+                } else {
+                    return {};
+                }
+            }
+
+            void push(const param _value) noexcept { stk.push(_value); }
+        };
+
+        struct Variables {
+            std::array<param, 26> small;
+            std::array<param, 26> big;
+        };
+
+        struct Context {
+            bool hasThen         = false;
+            bool hasElse         = false;
+            bool ignoreMode      = false;
+            bool scopeIgnoreMode = false;
+            Context(const bool _sim) : scopeIgnoreMode(_sim) {}
+            Context() = delete;
+        };
+
+        std::string result;
+        stkOfParams stk;
+        std::stack<Context, std::vector<Context>> conList;
+        std::ostringstream oss;
+        static Variables V{};
+
+        bool activeParse     = false;
+        bool incorrectString = false;
+        auto strLength       = s.length();
+
+        bool prependBase  = false;
+        bool prependSpace = false;
+        auto precision    = std::string::npos;
+
+        for (decltype(strLength) i = 0; i < strLength; ++i) {
+            // checks if % encoding has started
+            if (!activeParse) {
+                if (s[i] == '%') {
+                    activeParse = true;
+                } else {
+                    if (conList.empty()
+                        || (!conList.empty() && !conList.top().scopeIgnoreMode
+                            && !conList.top().ignoreMode)) {
+                        result += s[i];
+                    }
+                }
+                continue;
+            }
+
+            // % encoding has started from here
+
+            // conditional operations
+            bool isConditional = true;
+            switch (s[i]) {
+                case '?':
+                    conList.emplace(conList.empty() ? false
+                                                    : conList.top().ignoreMode);
+                    break;
+
+                case 't': {
+                    if (conList.empty()) {
+                        incorrectString = true;
+                        break;
+                    }
+                    if (conList.top().scopeIgnoreMode) {
+                        break;
+                    }
+
+                    auto p = stk.popNum();
+                    if (p) {
+                        conList.top().hasThen    = p.value() != 0;
+                        conList.top().ignoreMode = p.value() == 0;
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case 'e':
+                    if (conList.empty()) {
+                        incorrectString = true;
+                        break;
+                    }
+                    if (conList.top().scopeIgnoreMode) {
+                        break;
+                    }
+                    conList.top().ignoreMode = conList.top().hasThen;
+                    break;
+
+                case ';':
+                    if (!conList.empty()) {
+                        conList.pop();
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+
+                default: isConditional = false; break;
+            }
+
+            if (incorrectString) {
+                break;
+            }
+
+            if (isConditional
+                || (!conList.empty()
+                    && (conList.top().scopeIgnoreMode
+                        || conList.top().ignoreMode))) {
+                activeParse = false;
+                continue;
+            }
+
+            // non-condition operations
+            switch (s[i]) {
+                case '%': result += '%'; break;
+
+                case ':': {
+                FLAGS_LABEL:
+                    if (++i >= strLength) {
+                        incorrectString = true;
+                        break;
+                    }
+                    switch (s[i]) {
+                        case '-': oss << std::left; break;
+                        case '#': prependBase = true; break;
+                        case '+':
+                        case ' ':
+                            oss << std::showpos;
+                            prependSpace = (s[i] == ' ');
+                            break;
+                        default: incorrectString = true; break;
+                    }
+
+                    if ((++i) < strLength && s[i] != s[i - 1]) {
+                        if (isDigit(s[i])) {
+                            goto WIDTH_LABEL;
+                        } else if (s[i] == '.') {
+                            goto PRECISION_LABEL;
+                        } else if (isPopChar(s[i])) {
+                            goto POP_LABEL;
+                        } else if (isFlagChar(s[i])) {
+                            goto FLAGS_LABEL;
+                        } else {
+                            incorrectString = true;
+                        }
+                    } else {
+                        incorrectString = true;
+                    }
+
+                    break;
+                }
+
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9': {
+                WIDTH_LABEL:
+                    int w = s[i] - '0';
+                    while ((i + 1) < strLength && isDigit(s[i + 1])) {
+                        ++i;
+                        w = (w * 10) + (s[i] - '0');
+                    }
+                    oss << std::setw(w);
+
+                    if ((i + 1) < strLength) {
+                        if (s[i + 1] == '.') {
+                            ++i;
+                            goto PRECISION_LABEL;
+                        } else if (isPopChar(s[i])) {
+                            ++i;
+                            goto POP_LABEL;
+                        } else {
+                            incorrectString = true;
+                        }
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case '.': {
+                PRECISION_LABEL:
+                    if (++i >= strLength && !isDigit(s[i])) {
+                        incorrectString = true;
+                        break;
+                    }
+
+                    int p = s[i] - '0';
+                    while ((i + 1) < strLength && isDigit(s[i + 1])) {
+                        ++i;
+                        p = (p * 10) + (s[i] - '0');
+                    }
+                    precision = p;
+
+                    if ((i + 1) < strLength && isPopChar(s[i])) {
+                        ++i;
+                        goto POP_LABEL;
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case 'd':
+                case 'o':
+                case 'x':
+                case 'X': {
+                POP_LABEL:
+                    auto success = stk.popNum();
+                    if (success) {
+                        switch (s[i]) {
+                            case 'o':
+                                oss << (prependBase ? "0" : "") << std::oct;
+                                break;
+                            case 'x':
+                                oss << (prependBase ? "0x" : "") << std::hex;
+                                break;
+                            case 'X':
+                                oss << (prependBase ? "0X" : "") << std::hex;
+                                break;
+                        }
+                        oss << success.value();
+                        auto str = prependSpace
+                          ? oss.str().replace(oss.str().find('+'), 1, 1, ' ')
+                          : oss.str();
+                        result += str.substr(0, precision);
+                        oss.clear();
+                        oss.str("");
+                        prependBase  = false;
+                        prependSpace = false;
+                        precision    = std::string::npos;
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case 'c': {
+                    auto success = stk.popNum();
+                    if (success) {
+                        result += static_cast<char>(success.value());
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case 's': {
+                    auto success = stk.popString();
+                    if (success) {
+                        result += success.value();
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case 'p': {
+                    if (++i >= strLength) {
+                        incorrectString = true;
+                        break;
+                    }
+
+                    switch (s[i]) {
+                        case '1': stk.push(p1); break;
+                        case '2': stk.push(p2); break;
+                        case '3': stk.push(p3); break;
+                        case '4': stk.push(p4); break;
+                        case '5': stk.push(p5); break;
+                        case '6': stk.push(p6); break;
+                        case '7': stk.push(p7); break;
+                        case '8': stk.push(p8); break;
+                        case '9': stk.push(p9); break;
+                        default: incorrectString = true; break;
+                    }
+                    break;
+                }
+
+                case 'l': {
+                    auto success = stk.popString();
+                    if (success) {
+                        stk.push(success.value().length());
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case 'i': {
+                    try {
+                        auto &param1 = mpark::get<long>(p1);
+                        auto &param2 = mpark::get<long>(p2);
+                        ++param1;
+                        ++param2;
+                    } catch (mpark::bad_variant_access &e) {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case '!':
+                case '~': {
+                    auto success = stk.popNum();
+                    if (success) {
+                        if (s[i] == '!') {
+                            stk.push(!(success.value()));
+                        } else {
+                            stk.push(~(success.value()));
+                        }
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case '\'': {
+                    if (++i >= strLength) {
+                        incorrectString = true;
+                        break;
+                    }
+                    char ch = s[i];
+                    if (++i >= strLength || s[i] != '\'') {
+                        incorrectString = true;
+                        break;
+                    }
+                    stk.push(ch);
+                    ++i;
+                    break;
+                }
+
+                case '{': {
+                    if (++i >= strLength || !isdigit(s[i])) {
+                        incorrectString = true;
+                        break;
+                    }
+                    int num = s[i] - '0';
+                    if (++i >= strLength || !isdigit(s[i])) {
+                        if (s[i] == '}') {
+                            stk.push(num);
+                        } else {
+                            incorrectString = true;
+                        }
+                        break;
+                    }
+                    num = (num * 10) + (s[i] - '0');
+                    if (++i >= strLength || s[i] != '}') {
+                        incorrectString = true;
+                        break;
+                    }
+                    stk.push(num);
+                    break;
+                }
+
+                case '+':
+                case '-':
+                case '*':
+                case '/':
+                case 'm':
+                case '&':
+                case '|':
+                case '^':
+                case '=':
+                case '>':
+                case '<':
+                case 'A':
+                case 'O': {
+                    auto num1 = stk.popNum();
+                    if (!num1) {
+                        incorrectString = true;
+                        break;
+                    }
+                    auto num2 = stk.popNum();
+                    if (!num2) {
+                        incorrectString = true;
+                        break;
+                    }
+
+                    switch (s[i]) {
+                        case '+': stk.push(num1.value() + num2.value()); break;
+                        case '-': stk.push(num1.value() - num2.value()); break;
+                        case '*': stk.push(num1.value() * num2.value()); break;
+                        case '/': stk.push(num1.value() / num2.value()); break;
+                        case 'm': stk.push(num1.value() % num2.value()); break;
+                        case '&': stk.push(num1.value() & num2.value()); break;
+                        case '|': stk.push(num1.value() | num2.value()); break;
+                        case '^': stk.push(num1.value() ^ num2.value()); break;
+                        case '=': stk.push(num1.value() == num2.value()); break;
+                        case '>': stk.push(num1.value() > num2.value()); break;
+                        case '<': stk.push(num1.value() < num2.value()); break;
+                        case 'A': stk.push(num1.value() && num2.value()); break;
+                        case 'O': stk.push(num1.value() || num2.value()); break;
+                        default: incorrectString = true; break;
+                    }
+                    break;
+                }
+
+                case 'P': {
+                    if (++i >= strLength || !isAlpha(s[i])) {
+                        incorrectString = true;
+                        break;
+                    }
+                    if (s[i] >= 'A' && s[i] <= 'Z') {
+                        auto index   = s[i] - 'A';
+                        auto success = stk.pop();
+                        if (success) {
+                            V.big[index] = success.value();
+                        } else {
+                            incorrectString = true;
+                        }
+                    } else if (s[i] >= 'a' && s[i] <= 'z') {
+                        auto index   = s[i] - 'a';
+                        auto success = stk.pop();
+                        if (success) {
+                            V.small[index] = success.value();
+                        } else {
+                            incorrectString = true;
+                        }
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                case 'g': {
+                    if (++i >= strLength || !isAlpha(s[i])) {
+                        incorrectString = true;
+                        break;
+                    }
+                    if (s[i] >= 'A' && s[i] <= 'Z') {
+                        const auto index = s[i] - 'A';
+                        stk.push(V.big[index]);
+                    } else if (s[i] >= 'a' && s[i] <= 'z') {
+                        const auto index = s[i] - 'a';
+                        stk.push(V.small[index]);
+                    } else {
+                        incorrectString = true;
+                    }
+                    break;
+                }
+
+                default: incorrectString = true; break;
+            }
+
+            if (incorrectString) {
+                break;
+            }
+            activeParse = false;
+        }
+        return incorrectString ? "" : result;
+    }
+
+
+    std::string get(const std::string &raw, param p1, param p2, param p3,
+                    param p4, param p5, param p6, param p7, param p8,
+                    param p9)
+    {
+        static const std::regex pattern(delayStr, std::regex::optimize);
+
+        std::string result = raw;
+        escape(result);
+        result = std::regex_replace(result, pattern, "");
+        return parser(result, p1, p2, p3, p4, p5, p6, p7, p8, p9);
+    }
+}  // namespace reference
+
+// xterm's cursor_address and set_attributes
+const string capCup = "\x1b[%i%p1%d;%p2%dH";
+const string capSgr
+  = "%?%p9%t\x1b(0%e\x1b(B%;\x1b[0%?%p6%t;1%;%?%p5%t;2%;%?%p2%t;4%;"
+    "%?%p1%p3%|%t;7%;%?%p4%t;5%;%?%p7%t;8%;m";
+
+// what get() cost before capabilities were compiled
+void runReference(const string &cap, const int iterations)
+{
+    for (auto i = 0; i < iterations; ++i) {
+        reference::get(cap, long(i % 60), long(i % 200), 1l, 0l, 0l, 1l, 0l,
+                       0l, 0l);
+    }
+}
+
+// compiles the capability again on every call, the cost of compiling
+// and not the escape, regex and parser interpreter get() used to run
+void runRecompiled(const string &cap, const int iterations)
+{
+    detail::Variables V{};
+    string out;
+    for (auto i = 0; i < iterations; ++i) {
+        detail::Bytecode bc;
+        detail::Program prog;
+        array<param, 9> p{ { long(i % 60), long(i % 200), 1l, 0l, 0l, 1l, 0l,
+                             0l, 0l } };
+        bc.compile(cap, prog);
+        out.clear();
+        bc.execute(prog, p, &V, out);
+    }
+}
+
+void runCompiled(const string &cap, const int iterations)
+{
+    detail::Variables V{};
+    detail::Bytecode bc;
+    detail::Program prog;
+    bc.compile(cap, prog);
+    string out;
+    for (auto i = 0; i < iterations; ++i) {
+        array<param, 9> p{ { long(i % 60), long(i % 200), 1l, 0l, 0l, 1l, 0l,
+                             0l, 0l } };
+        out.clear();
+        bc.execute(prog, p, &V, out);
+    }
+}
+
+// integer parameters, no param is built
+void runTyped(const string &cap, const int iterations)
+{
+    detail::Bytecode bc;
+    detail::Program prog;
+    bc.compile(cap, prog);
+    string out;
+    for (auto i = 0; i < iterations; ++i) {
+        array<long, 9> p{ { i % 60, i % 200, 1, 0, 0, 1, 0, 0, 0 } };
+        out.clear();
+        bc.execute(prog, p, out);
+    }
+}
+
+// a full repaint of cursor motions, 'frames' times
+void runRepaint(const TermDb &parser, const int frames)
+{
+    string out;
+    for (auto f = 0; f < frames; ++f) {
+        out.clear();
+        for (auto row = 0; row < 60; ++row) {
+            for (auto col = 0; col < 200; ++col) {
+                parser.append(str::cursor_address, out, row, col);
+            }
+        }
+    }
+}
+
+// the same repaint, one get() and one string per move
+void runPerCall(const TermDb &parser, const int frames)
+{
+    string out;
+    for (auto f = 0; f < frames; ++f) {
+        out.clear();
+        for (auto row = 0; row < 60; ++row) {
+            for (auto col = 0; col < 200; ++col) {
+                out += parser.get(str::cursor_address, row, col);
+                out += ' ';
+            }
+        }
+    }
+}
+
+// and as a batch, built again for every frame unless 'reuse' is set
+void runBatch(const TermDb &parser, const int frames, const bool reuse)
+{
+    string out;
+    Batch batch;
+    batch.reserve(200 * 60 * 2);
+    for (auto f = 0; f < frames; ++f) {
+        out.clear();
+        if (!reuse || batch.empty()) {
+            batch.clear();
+            for (auto row = 0; row < 60; ++row) {
+                for (auto col = 0; col < 200; ++col) {
+                    batch.moveTo(row, col).text(" ", 1);
+                }
+            }
+        }
+        parser.append(batch, out);
+    }
+}
+
+// bytes written for moves between pseudo random cells, most of them
+// short like a typical repaint
+void runPlanner(const TermDb &parser, const int moves)
+{
+    CursorPlanner planner(parser);
+    string planned, absolute;
+    unsigned seed = 1;
+    long row = 0, col = 0;
+    for (auto i = 0; i < moves; ++i) {
+        seed           = seed * 1103515245u + 12345u;
+        const auto far = (seed >> 16) % 8 == 0;
+        const long r   = far ? (seed >> 8) % 60
+                             : min<long>(row + (seed >> 20) % 2, 59);
+        const long c   = far ? (seed >> 4) % 200 : (seed >> 12) % 200;
+        planner.append(planned, row, col, r, c);
+        parser.append(str::cursor_address, absolute, r, c);
+        row = r;
+        col = c;
+    }
+    cout << "planned moves: " << planned.size() << " bytes, cursor_address "
+         << absolute.size() << " bytes\n";
 }
 
 int main()
 {
+    constexpr auto iterations = 200000;
+    cout << "cup reference:   "
+         << measure<>::execution(runReference, capCup, iterations)
+         << " microseconds\n"
+         << "cup recompiled:  "
+         << measure<>::execution(runRecompiled, capCup, iterations)
+         << " microseconds\n"
+         << "cup compiled:    "
+         << measure<>::execution(runCompiled, capCup, iterations)
+         << " microseconds\n"
+         << "cup typed:       "
+         << measure<>::execution(runTyped, capCup, iterations)
+         << " microseconds\n"
+         << "sgr reference:   "
+         << measure<>::execution(runReference, capSgr, iterations)
+         << " microseconds\n"
+         << "sgr recompiled:  "
+         << measure<>::execution(runRecompiled, capSgr, iterations)
+         << " microseconds\n"
+         << "sgr compiled:    "
+         << measure<>::execution(runCompiled, capSgr, iterations)
+         << " microseconds\n"
+         << "sgr typed:       "
+         << measure<>::execution(runTyped, capSgr, iterations)
+         << " microseconds\n";
+
     ifstream names("stressTestTerms.txt");
     if (!names) {
         return -1;
@@ -56,15 +1039,54 @@ int main()
         nameList.emplace_back(name);
     }
 
-    vector<TermDb> parsers;
-    parsers.reserve(nameList.size());
+    // the first run only warms up the page cache
+    isolated(loadCorpus, nameList);
+    isolated(loadCorpus, nameList);
+    if (!Image::write("mirror/", "terminfo.img")) {
+        isolated(loadImage, nameList);
+    }
+    isolated(loadIndexed, nameList);
+    isolated(loadShared, nameList, false);
+    isolated(loadShared, nameList, true);
+    isolated(loadProbed, nameList, Decode::Eager);
+    isolated(loadProbed, nameList, Decode::Lazy);
+
+    runFuzz(nameList, 5);
+
+    cout << "resolve probing: " << measure<>::execution(runProbing, nameList)
+         << " microseconds\n";
+    SearchPath search(searchDirs);
+    cout << "resolve cold:    "
+         << measure<>::execution(runSearch, search, nameList)
+         << " microseconds\n"
+         << "resolve warm:    "
+         << measure<>::execution(runSearch, search, nameList)
+         << " microseconds\n";
+    SearchPath checked(searchDirs, chrono::milliseconds(0));
     for (auto &term : nameList) {
-        try {
-            parsers.emplace_back(term, "mirror/");
-        } catch (error_code &e) {
-            cerr << '\n' << e << ": " << e.message();
-        }
+        checked.resolve(term);
     }
+    cout << "resolve warm, always rechecked: "
+         << measure<>::execution(runSearch, checked, nameList)
+         << " microseconds\n";
 
-    cout << measure<>::execution(runParser, parsers) << " microseconds" << endl;
+    TermDb xterm("xterm", "mirror/");
+    const auto planned = measure<>::execution(runPlanner, xterm, 100000);
+    cout << "planner, 100000 moves: " << planned << " microseconds\n";
+    cout << "grid per call:     " << measure<>::execution(runPerCall, xterm, 20)
+         << " microseconds\n"
+         << "grid batch:        "
+         << measure<>::execution(runBatch, xterm, 20, false)
+         << " microseconds\n"
+         << "grid batch reused: "
+         << measure<>::execution(runBatch, xterm, 20, true)
+         << " microseconds\n";
+    cout << "repaint uncached: " << measure<>::execution(runRepaint, xterm, 20)
+         << " microseconds\n";
+    xterm.setCache(unique_ptr<ResultCache>(new LruCache(200 * 60)));
+    cout << "repaint lru:      " << measure<>::execution(runRepaint, xterm, 20)
+         << " microseconds\n";
+    xterm.setCache(unique_ptr<ResultCache>(new DenseCache(60, 200)));
+    cout << "repaint dense:    " << measure<>::execution(runRepaint, xterm, 20)
+         << " microseconds\n";
 }
@@ -0,0 +1,369 @@
+#include "allocations.hpp"
+#include "termdb.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+using namespace tdb;
+using namespace std;
+
+/*
+    Micro benchmarks by group, each case reporting ns/op, allocations/op
+    and percentiles over its samples. Runs from the build directory after
+    extract_data, like bench.
+
+    usage: microBench [--json file] [--baseline file] [--threshold ratio]
+                      [--samples n] [group...]
+
+    --json writes the results, a file written that way can be given as
+    --baseline to a later run, which then fails if the median ns/op of
+    a case grew by more than the threshold ratio (1.25 by default) or it
+    allocates more. Cases missing from the baseline aren't compared.
+*/
+
+struct Result {
+    string name;
+    size_t ops         = 0;  // per sample
+    size_t samples     = 0;
+    double nsPerOp     = 0;  // mean over all samples
+    double p50         = 0;  // ns/op of the samples
+    double p90         = 0;
+    double p99         = 0;
+    double allocsPerOp = 0;
+};
+
+// what ops return is summed here, so that they can't be optimized away
+static volatile size_t sink;
+
+class Suite {
+    size_t samples;
+    vector<Result> results;
+
+    // ns/op of a single sample of 'ops' operations
+    template <typename F>
+    static double sample(F &op, size_t ops)
+    {
+        size_t sum       = 0;
+        const auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            sum += op(i);
+        }
+        const chrono::duration<double, nano> elapsed
+          = chrono::steady_clock::now() - start;
+        sink = sum;
+        return elapsed.count() / ops;
+    }
+
+public:
+    explicit Suite(size_t _samples) : samples(_samples) {}
+
+    const vector<Result> &all() const noexcept { return results; }
+
+    // 'op(i)' is one operation, samples take at least a millisecond
+    template <typename F>
+    void run(const string &name, F op)
+    {
+        size_t ops = 1;
+        while (sample(op, ops) * ops < 1e6 && ops < (1u << 24)) {
+            ops *= 2;
+        }
+
+        vector<double> times;
+        times.reserve(samples);
+        double total       = 0;
+        const auto counted = allocations.load();
+        for (size_t s = 0; s < samples; ++s) {
+            times.push_back(sample(op, ops));
+            total += times.back();
+        }
+        const auto allocated = allocations.load() - counted;
+
+        sort(times.begin(), times.end());
+        const auto at = [&times](double p) {
+            return times[static_cast<size_t>(p * (times.size() - 1) + 0.5)];
+        };
+        Result r;
+        r.name        = name;
+        r.ops         = ops;
+        r.samples     = samples;
+        r.nsPerOp     = total / samples;
+        r.p50         = at(0.5);
+        r.p90         = at(0.9);
+        r.p99         = at(0.99);
+        r.allocsPerOp = double(allocated) / (ops * samples);
+        results.push_back(r);
+
+        cout << left << setw(24) << name << right << fixed << setprecision(1)
+             << setw(14) << r.nsPerOp << setw(14) << r.p50 << setw(14) << r.p90
+             << setw(14) << r.p99 << setprecision(2) << setw(12)
+             << r.allocsPerOp << '\n';
+    }
+};
+
+void writeJson(const vector<Result> &results, ostream &out)
+{
+    out << "{\n  \"benchmarks\": [\n" << setprecision(3) << fixed;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto &r = results[i];
+        out << "    { \"name\": \"" << r.name << "\", \"ops\": " << r.ops
+            << ", \"samples\": " << r.samples
+            << ", \"ns_per_op\": " << r.nsPerOp << ", \"p50\": " << r.p50
+            << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99
+            << ", \"allocs_per_op\": " << r.allocsPerOp << " }"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// a number following "key": on 'line', 0 if there is none
+double field(const string &line, const string &key)
+{
+    const auto at = line.find('"' + key + "\": ");
+    if (at == string::npos) {
+        return 0;
+    }
+    return strtod(line.c_str() + at + key.size() + 4, nullptr);
+}
+
+// results from a file written by writeJson(), one case per line
+map<string, Result> readJson(istream &in)
+{
+    map<string, Result> results;
+    string line;
+    while (getline(in, line)) {
+        const string key = "\"name\": \"";
+        const auto at    = line.find(key);
+        if (at == string::npos) {
+            continue;
+        }
+        const auto begin = at + key.size();
+        Result r;
+        r.name        = line.substr(begin, line.find('"', begin) - begin);
+        r.nsPerOp     = field(line, "ns_per_op");
+        r.p50         = field(line, "p50");
+        r.allocsPerOp = field(line, "allocs_per_op");
+        results[r.name] = r;
+    }
+    return results;
+}
+
+// number of cases which got slower than 'threshold' times the baseline
+// or allocate more, medians within 'slack' ns of the baseline don't
+// count as slower whatever the ratio, for cases of a few ns or a zero
+// baseline
+size_t compare(const vector<Result> &results,
+               const map<string, Result> &baseline, double threshold,
+               double slack = 1.0)
+{
+    size_t regressions = 0;
+    for (const auto &r : results) {
+        const auto base = baseline.find(r.name);
+        if (base == baseline.end()) {
+            continue;
+        }
+        const auto was    = base->second.p50;
+        const auto slower = r.p50 > was * threshold && r.p50 - was > slack;
+        const auto allocating
+          = r.allocsPerOp > base->second.allocsPerOp + 0.01;
+        if (slower || allocating) {
+            ++regressions;
+            cout << "regression: " << r.name << setprecision(1) << ", "
+                 << r.p50 << " ns against " << was << " ns, "
+                 << setprecision(2) << r.allocsPerOp << " allocs/op against "
+                 << base->second.allocsPerOp << '\n';
+        }
+    }
+    return regressions;
+}
+
+void loadGroup(Suite &suite)
+{
+    suite.run("load cold", [](size_t) {
+        detail::Description db;
+        return static_cast<size_t>(!db.loadDB("xterm", "mirror/"));
+    });
+    suite.run("load cold lazy", [](size_t) {
+        detail::Description db;
+        db.decodeLazily();
+        return static_cast<size_t>(!db.loadDB("xterm", "mirror/"));
+    });
+    auto &registry = Registry::global();
+    suite.run("load warm", [&registry](size_t) {
+        return static_cast<size_t>(registry.load("xterm", "mirror/")
+                                   != nullptr);
+    });
+}
+
+void lookupGroup(Suite &suite, const TermDb &xterm)
+{
+    suite.run("bool lookup", [&xterm](size_t i) {
+        return static_cast<size_t>(
+          xterm.get(static_cast<bin>(i % numCapBool)));
+    });
+    suite.run("num lookup", [&xterm](size_t i) {
+        const auto n = xterm.get(static_cast<num>(i % numCapNum));
+        return static_cast<size_t>(n.value_or(0));
+    });
+}
+
+void stringGroup(Suite &suite, const TermDb &xterm)
+{
+    static const str plain[]
+      = { str::clear_screen,     str::cursor_home,
+          str::enter_bold_mode,  str::exit_attribute_mode,
+          str::cursor_invisible, str::cursor_normal,
+          str::carriage_return,  str::bell };
+    constexpr auto count = sizeof(plain) / sizeof(plain[0]);
+    suite.run("string lookup", [&xterm](size_t i) {
+        return xterm.get(plain[i % count]).size();
+    });
+    char buf[256];
+    suite.run("string into buffer", [&xterm, &buf](size_t i) {
+        return xterm.getInto(plain[i % count], buf, sizeof(buf));
+    });
+}
+
+void paramGroup(Suite &suite, const TermDb &xterm)
+{
+    suite.run("cursor_address", [&xterm](size_t i) {
+        return xterm.get(str::cursor_address, i % 60, i % 200).size();
+    });
+    string out;
+    suite.run("cursor_address append", [&xterm, &out](size_t i) {
+        out.clear();
+        xterm.append(str::cursor_address, out, i % 60, i % 200);
+        return out.size();
+    });
+    suite.run("sgr", [&xterm](size_t i) {
+        const long bold = i & 1, reverse = (i >> 1) & 1, blink = (i >> 2) & 1;
+        return xterm
+          .get(str::set_attributes, bold, 0, reverse, 0, 0, blink, 0, 0, 0)
+          .size();
+    });
+}
+
+// ops are whole corpus loads, or sweeps of every capability of it
+void corpusGroup(Suite &suite, const vector<string> &nameList)
+{
+    suite.run("corpus load", [&nameList](size_t) {
+        return loadAll(nameList, "mirror/", 1).size();
+    });
+    suite.run("corpus load lazy", [&nameList](size_t) {
+        return loadAll(nameList, "mirror/", 1, Decode::Lazy).size();
+    });
+
+    vector<TermDb> parsers;
+    for (const auto &result : loadAll(nameList, "mirror/", 1)) {
+        if (result.entry) {
+            parsers.emplace_back(result.entry);
+        }
+    }
+    suite.run("corpus sweep", [&parsers](size_t) {
+        size_t sum = 0;
+        for (const auto &parser : parsers) {
+            for (auto b = 0; b < numCapBool; ++b) {
+                sum += parser.get(static_cast<bin>(b));
+            }
+            for (auto n = 0; n < numCapNum; ++n) {
+                sum += parser.get(static_cast<num>(n)).value_or(0);
+            }
+            for (auto s = 0; s < numCapStr; ++s) {
+                sum += parser
+                         .get(static_cast<str>(s), 1, 1, 1, 1, 1, 1, 1, 1, 1)
+                         .size();
+            }
+        }
+        return sum;
+    });
+}
+
+int main(int argc, char *argv[])
+{
+    string json, baselinePath;
+    double threshold = 1.25;
+    size_t samples   = 21;
+    vector<string> groups;
+    for (auto i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (i + 1 < argc && arg == "--json") {
+            json = argv[++i];
+        } else if (i + 1 < argc && arg == "--baseline") {
+            baselinePath = argv[++i];
+        } else if (i + 1 < argc && arg == "--threshold") {
+            threshold = strtod(argv[++i], nullptr);
+        } else if (i + 1 < argc && arg == "--samples") {
+            samples = max(1l, strtol(argv[++i], nullptr, 10));
+        } else if (arg.compare(0, 2, "--") == 0) {
+            cerr << "usage: " << argv[0]
+                 << " [--json file] [--baseline file] [--threshold ratio]"
+                    " [--samples n] [load|lookup|string|params|corpus]...\n";
+            return 2;
+        } else {
+            groups.push_back(arg);
+        }
+    }
+    const auto selected = [&groups](const string &group) {
+        return groups.empty()
+          || find(groups.begin(), groups.end(), group) != groups.end();
+    };
+
+    map<string, Result> baseline;
+    if (!baselinePath.empty()) {
+        ifstream in(baselinePath);
+        if (!in) {
+            cerr << baselinePath << ": can't be read\n";
+            return 2;
+        }
+        baseline = readJson(in);
+    }
+
+    vector<string> nameList;
+    ifstream names("stressTestTerms.txt");
+    string name;
+    while (getline(names, name)) {
+        nameList.emplace_back(name);
+    }
+    if (nameList.empty()) {
+        cerr << "stressTestTerms.txt is missing, run extract_data first\n";
+        return 2;
+    }
+
+    Suite suite(samples);
+    try {
+        const TermDb xterm("xterm", "mirror/");
+        cout << left << setw(24) << "case" << right << setw(14) << "ns/op"
+             << setw(14) << "p50" << setw(14) << "p90" << setw(14) << "p99"
+             << setw(12) << "allocs/op" << '\n';
+        if (selected("load")) {
+            loadGroup(suite);
+        }
+        if (selected("lookup")) {
+            lookupGroup(suite, xterm);
+        }
+        if (selected("string")) {
+            stringGroup(suite, xterm);
+        }
+        if (selected("params")) {
+            paramGroup(suite, xterm);
+        }
+        if (selected("corpus")) {
+            corpusGroup(suite, nameList);
+        }
+    } catch (error_code &e) {
+        cerr << "xterm: " << e.message() << '\n';
+        return 2;
+    }
+
+    if (!json.empty()) {
+        ofstream out(json);
+        writeJson(suite.all(), out);
+        if (!out) {
+            cerr << json << ": can't be written\n";
+            return 2;
+        }
+    }
+    return compare(suite.all(), baseline, threshold) ? 1 : 0;
+}
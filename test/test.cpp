@@ -1,7 +1,9 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
+#include "allocations.hpp"
 #include "termdb.hpp"
+#include <thread>
 
 using namespace tdb;
 
@@ -75,6 +77,37 @@ TEST_CASE("Corrupted Database")
 }
 
 
+TEST_CASE("Odd alignment")
+{
+    // names and booleans take 3 bytes, a null byte aligns the numbers,
+    // the string table ends on the last byte of the file
+    const char bytes[] = { 0x1a, 0x01, 2, 0, 1, 0, 0, 0, 1, 0, 2, 0,
+                           'x',  0,    1, 0, 0, 0, 'A', 0 };
+    ::mkdir("odd", 0755);
+    ::mkdir("odd/x", 0755);
+    std::ofstream("odd/x/x", std::ios::binary).write(bytes, sizeof(bytes));
+    std::ofstream("odd/x/short", std::ios::binary)
+      .write(bytes, sizeof(bytes) - 1);
+
+    for (const auto map : { true, false }) {
+        detail::Description exact;
+        REQUIRE_FALSE(exact.loadFile("odd/x/x", map));
+        REQUIRE(exact.getName() == "x");
+        detail::Description truncated;
+        REQUIRE(truncated.loadFile("odd/x/short", map)
+                == ParseError::BadDatabase);
+    }
+    TermDb parser("x", "odd/");
+    REQUIRE(parser.get(bin::auto_left_margin));
+    REQUIRE(parser.get(str::back_tab) == "A");
+
+    std::remove("odd/x/x");
+    std::remove("odd/x/short");
+    ::rmdir("odd/x");
+    ::rmdir("odd");
+}
+
+
 TEST_CASE("DataResets successfully")
 {
     TermDb parser;
@@ -142,3 +175,845 @@ TEST_CASE("Numbers")
 
     REQUIRE(parsedNums.size() == hardNums.size());
 }
+
+
+TEST_CASE("Strings")
+{
+    TermDb parser("xterm", "terminfo/");
+
+    REQUIRE(parser.get(str::clear_screen) == "\x1b[H\x1b[2J");
+    REQUIRE(parser.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+    REQUIRE(parser.get(str::parm_down_cursor, 12) == "\x1b[12B");
+    REQUIRE(parser.get(str::set_a_foreground, 3) == "\x1b[33m");
+    REQUIRE(parser.get(str::enter_ca_mode) == "\x1b[?1049h");
+
+    // padding is stripped
+    REQUIRE(parser.get(str::flash_screen) == "\x1b[?5h\x1b[?5l");
+    REQUIRE(parser.get(str::insert_padding).size() == 0);
+}
+
+
+TEST_CASE("Strings without allocations")
+{
+    TermDb parser("xterm", "terminfo/");
+    char buf[64];
+
+    const auto before = allocations.load();
+    auto n = parser.getInto(str::cursor_address, buf, sizeof(buf), 4, 7);
+    n += parser.getInto(str::clear_screen, buf + n, sizeof(buf) - n);
+    n += parser.getInto(str::set_a_background, buf + n, sizeof(buf) - n, 4);
+    REQUIRE(allocations == before);
+    REQUIRE(std::string(buf, n) == "\x1b[5;8H\x1b[H\x1b[2J\x1b[44m");
+
+    // truncated output reports the full length
+    REQUIRE(parser.getInto(str::cursor_address, buf, 3, 4, 7) == 6);
+    REQUIRE(parser.getInto(str::cursor_address, buf, 0, 40, 70) == 8);
+
+    std::string out;
+    out.reserve(64);
+    const auto mark = allocations.load();
+    parser.append(str::cursor_address, out, 4, 7);
+    parser.append(str::clear_screen, out);
+    parser.append(str::set_a_foreground, out, 1);
+    REQUIRE(allocations == mark);
+    REQUIRE(out == "\x1b[5;8H\x1b[H\x1b[2J\x1b[31m");
+}
+
+
+// a compiled entry named "s" whose only string capability, back_tab,
+// is 'cap'
+static std::string entryWith(const std::string &cap)
+{
+    const auto table = cap.size() + 1;
+    std::string bytes{ 0x1a, 0x01, 2, 0, 0, 0, 0, 0, 1, 0 };
+    bytes += static_cast<char>(table & 0xff);
+    bytes += static_cast<char>(table >> 8);
+    bytes.append("s", 2).append(2, '\0').append(cap.c_str(), table);
+    return bytes;
+}
+
+TEST_CASE("Static variables")
+{
+    // prints A, then stores the first parameter in it
+    const auto bytes = entryWith("%gA%d%p1%PA");
+    std::error_code ec;
+    const auto entry = loadFromMemory(bytes.data(), bytes.size(), ec);
+    REQUIRE(entry);
+
+    // kept between calls on one object
+    TermDb first(entry);
+    REQUIRE(first.get(str::back_tab, 5) == "0");
+    REQUIRE(first.get(str::back_tab, 7) == "5");
+    REQUIRE(first.get(str::back_tab, 9) == "7");
+
+    // another object sharing the description has its own
+    TermDb second(entry);
+    REQUIRE(second.get(str::back_tab, 3) == "0");
+    REQUIRE(first.get(str::back_tab, 1) == "9");
+
+    // and attach() or parsing start over
+    first.attach(entry);
+    REQUIRE(first.get(str::back_tab, 4) == "0");
+    REQUIRE(first.parseFromMemory(bytes.data(), bytes.size()));
+    REQUIRE(first.get(str::back_tab, 2) == "0");
+    REQUIRE(second.get(str::back_tab, 8) == "3");
+}
+
+TEST_CASE("Concurrent strings")
+{
+    const TermDb parser("xterm", "terminfo/");
+    const auto bytes = entryWith("%gA%d%p1%PA");
+    std::error_code ec;
+    const TermDb counter(loadFromMemory(bytes.data(), bytes.size(), ec));
+
+    // every thread moves over its own rows of the screen and stores its
+    // index in A, which any thread might read back afterwards
+    std::vector<std::string> failures(4);
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            for (auto row = t; row < 60; row += 4) {
+                for (auto col = 0; col < 80; ++col) {
+                    const auto cup = parser.get(str::cursor_address, row, col);
+                    if (cup
+                        != "\x1b[" + std::to_string(row + 1) + ';'
+                          + std::to_string(col + 1) + 'H') {
+                        failures[t] = cup;
+                    }
+                    const auto seen = counter.get(str::back_tab, t + 1);
+                    if (seen.size() != 1 || seen[0] < '0' || seen[0] > '4') {
+                        failures[t] = seen;
+                    }
+                }
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (const auto &failure : failures) {
+        REQUIRE(failure.empty());
+    }
+}
+
+TEST_CASE("Registry")
+{
+    Registry registry;
+    std::error_code ec;
+
+    auto first = registry.load("xterm", "terminfo/", ec);
+    REQUIRE(first);
+    REQUIRE_FALSE(ec);
+    REQUIRE(registry.load("xterm", "terminfo/") == first);
+    REQUIRE(registry.load("adm3a", "terminfo/") != first);
+
+    REQUIRE_FALSE(registry.load("NON_EXISTENT_TERM_FOR_DEMO", "terminfo/", ec));
+    REQUIRE(ec == ParseError::ReadError);
+    REQUIRE(registry.size() == 2);
+
+    // failed loads take no room, however many names are tried
+    for (auto i = 0; i < 200; ++i) {
+        registry.load("missing" + std::to_string(i), "terminfo/", ec);
+        REQUIRE(ec == ParseError::ReadError);
+    }
+    REQUIRE(registry.size() == 2);
+
+    // every thread gets the same description
+    std::vector<Registry::Entry> entries(8);
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < entries.size(); ++i) {
+        threads.emplace_back(
+          [&, i]() { entries[i] = registry.load("adm3a", "terminfo/"); });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (auto &e : entries) {
+        REQUIRE(e == entries[0]);
+    }
+
+    TermDb parser(first);
+    REQUIRE(parser);
+    REQUIRE(parser.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+    REQUIRE(parser.attach(entries[0]));
+    REQUIRE(parser.getName() == "adm3a|lsi adm3a");
+    REQUIRE_FALSE(parser.attach(nullptr));
+}
+
+
+TEST_CASE("Extended number format")
+{
+    TermDb legacy("xterm", "terminfo/");
+    REQUIRE(legacy.get(num::max_colors).value() == 8);
+
+    TermDb direct("xterm-direct", "terminfo/");
+    REQUIRE(direct.get(num::max_colors).value() == 0x1000000);
+    REQUIRE(direct.get(num::max_pairs).value() == 0x10000);
+    REQUIRE(direct.get(num::columns).value() == 80);
+    REQUIRE_FALSE(direct.get(num::magic_cookie_glitch));
+    REQUIRE(direct.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+
+    TermDb colors("xterm-256color", "terminfo/");
+    REQUIRE(colors.get(num::max_colors).value() == 256);
+    REQUIRE(colors.get(str::set_a_foreground, 12) == "\x1b[94m");
+    REQUIRE(colors.get(str::set_a_foreground, 200) == "\x1b[38;5;200m");
+}
+
+
+TEST_CASE("Extended capabilities")
+{
+    TermDb legacy("xterm", "terminfo/");
+    REQUIRE(legacy.getExtBool("AX"));
+    REQUIRE(legacy.getExtBool("XT"));
+    REQUIRE_FALSE(legacy.getExtBool("RGB"));
+    REQUIRE(legacy.getExtStr("Ss", 2) == "\x1b[2 q");
+    REQUIRE(legacy.getExtStr("Ms", std::string("c"), std::string("dGVzdA=="))
+            == "\x1b]52;c;dGVzdA==\x07");
+
+    TermDb direct("xterm-direct", "terminfo/");
+    REQUIRE(direct.getExtBool("RGB"));
+    REQUIRE(direct.getExtNum("CO").value() == 8);
+    REQUIRE_FALSE(direct.getExtNum("RGB"));
+    REQUIRE_FALSE(direct.getExtNum("Tc"));
+    REQUIRE(direct.getExtStr("kxIN") == "\x1b[I");
+    REQUIRE(direct.getExtStr("XM", 1) == "\x1b[?1006;1000h");
+    REQUIRE(direct.getExtStr("Smulx", 3).size() == 0);
+
+    // standard capabilities are unaffected
+    REQUIRE(direct.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+}
+
+TEST_CASE("Capability names")
+{
+    static_assert(strByName("cup") == str::cursor_address, "");
+    static_assert(strByName("cursor_address") == str::cursor_address, "");
+    static_assert(numByName("colors") == num::max_colors, "");
+    static_assert(binByName("am") == bin::auto_right_margin, "");
+
+    REQUIRE(std::string(shortName(str::enter_ca_mode)) == "smcup");
+    REQUIRE(std::string(longName(str::enter_ca_mode)) == "enter_ca_mode");
+    REQUIRE(std::string(shortName(num::lines)) == "lines");
+    REQUIRE(std::string(longName(bin::return_does_clr_eol)) ==
+            "return_does_clr_eol");
+
+    for (int i = 0; i < numCapStr; ++i) {
+        auto cap = static_cast<str>(i);
+        REQUIRE(findStr(shortName(cap)).value() == cap);
+        REQUIRE(findStr(longName(cap)).value() == cap);
+    }
+    for (int i = 0; i < numCapNum; ++i) {
+        auto cap = static_cast<num>(i);
+        REQUIRE(findNum(shortName(cap)).value() == cap);
+        REQUIRE(findNum(longName(cap)).value() == cap);
+    }
+    for (int i = 0; i < numCapBool; ++i) {
+        auto cap = static_cast<bin>(i);
+        REQUIRE(findBin(shortName(cap)).value() == cap);
+        REQUIRE(findBin(longName(cap)).value() == cap);
+    }
+
+    REQUIRE_FALSE(findStr("cu"));
+    REQUIRE_FALSE(findStr("cupp"));
+    REQUIRE_FALSE(findStr(""));
+    REQUIRE_FALSE(findStr("colors"));
+    REQUIRE_FALSE(findNum("cup"));
+    REQUIRE_THROWS(strByName("nonexistent"));
+}
+
+TEST_CASE("Typed parameters")
+{
+    TermDb parser("xterm", "terminfo/");
+    REQUIRE(parser.signature(str::cursor_address).value().count == 2);
+    REQUIRE(parser.signature(str::cursor_address).value().strings == 0);
+    REQUIRE(parser.signature(str::set_attributes).value().count == 9);
+    REQUIRE(parser.signature(str::clear_screen).value().count == 0);
+    REQUIRE_FALSE(parser.signature(str::pkey_key));
+
+    short row         = 4;
+    unsigned long col = 7;
+    REQUIRE(parser.get(str::cursor_address, row, col) == "\x1b[5;8H");
+    REQUIRE(parser.get(str::cursor_address, param(4l), 7) == "\x1b[5;8H");
+    REQUIRE(parser.get(str::column_address, -3) == "\x1b[-2G");
+
+    // string parameters go through params
+    REQUIRE(parser.getExtStr("Ms", "c", std::string("dGVzdA=="))
+            == "\x1b]52;c;dGVzdA==\x07");
+    // and numbers where strings are expected fail as before
+    REQUIRE(parser.getExtStr("Ms", 1, 2).empty());
+}
+
+TEST_CASE("Result cache")
+{
+    TermDb parser("xterm", "terminfo/");
+    parser.setCache(std::unique_ptr<ResultCache>(new LruCache(2)));
+    REQUIRE(parser.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+    REQUIRE(parser.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+    REQUIRE(parser.get(str::cursor_address, 4, 7, 1) == "\x1b[5;8H");
+    REQUIRE(parser.cacheStats().hits == 2);
+    REQUIRE(parser.cacheStats().misses == 1);
+
+    // the least recently used result goes first
+    REQUIRE(parser.get(str::cursor_address, 1, 1) == "\x1b[2;2H");
+    REQUIRE(parser.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+    REQUIRE(parser.get(str::column_address, 3) == "\x1b[4G");
+    REQUIRE(parser.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+    REQUIRE(parser.get(str::cursor_address, 1, 1) == "\x1b[2;2H");
+    REQUIRE(parser.cacheStats().hits == 4);
+    REQUIRE(parser.cacheStats().misses == 4);
+
+    // string parameters are never cached
+    parser.getExtStr("Ms", "c", "dGVzdA==");
+    char buf[8];
+    REQUIRE(parser.getInto(str::cursor_address, buf, sizeof(buf), 1, 1) == 6);
+    REQUIRE(std::string(buf, 6) == "\x1b[2;2H");
+    REQUIRE(parser.cacheStats().hits == 5);
+    REQUIRE(parser.cacheStats().misses == 4);
+
+    // copies start with an empty cache of the same kind
+    TermDb screen("xterm-256color", "terminfo/");
+    screen.setCache(std::unique_ptr<ResultCache>(new DenseCache(24, 80)));
+    TermDb copy = screen;
+    for (auto i = 0; i < 2; ++i) {
+        REQUIRE(copy.get(str::cursor_address, 23, 79) == "\x1b[24;80H");
+        REQUIRE(copy.get(str::set_a_foreground, 200) == "\x1b[38;5;200m");
+        REQUIRE(copy.get(str::cursor_address, 24, 0) == "\x1b[25;1H");
+    }
+    // row 24 is off the screen, it misses every time
+    REQUIRE(copy.cacheStats().hits == 2);
+    REQUIRE(copy.cacheStats().misses == 4);
+    REQUIRE(screen.cacheStats().misses == 0);
+}
+
+TEST_CASE("Batches")
+{
+    TermDb parser("xterm", "terminfo/");
+    Batch batch;
+    batch.add(str::clear_screen)
+      .moveTo(4, 7)
+      .text("ab")
+      .add(str::column_address, 2)
+      .add(str::enter_bold_mode)
+      .text(std::string("c"));
+    REQUIRE(batch.size() == 6);
+
+    const std::string expected = parser.get(str::clear_screen)
+      + "\x1b[5;8Hab\x1b[3G" + parser.get(str::enter_bold_mode) + "c";
+    std::string out = "x";
+    REQUIRE(parser.append(batch, out));
+    REQUIRE(out == "x" + expected);
+
+    char buf[64];
+    REQUIRE(parser.getInto(batch, buf, sizeof(buf)) == expected.size());
+    REQUIRE(std::string(buf, expected.size()) == expected);
+    REQUIRE(parser.getInto(batch, buf, 4) == expected.size());
+
+    // missing capabilities are left out
+    TermDb adm3a("adm3a", "terminfo/");
+    batch.clear();
+    batch.text("a").add(str::enter_bold_mode).text("b");
+    out.clear();
+    REQUIRE_FALSE(adm3a.append(batch, out));
+    REQUIRE(out == "ab");
+}
+
+TEST_CASE("Cursor planner")
+{
+    TermDb parser("xterm", "terminfo/");
+    CursorPlanner planner(parser);
+
+    REQUIRE(planner.move(5, 5, 5, 5) == "");
+    REQUIRE(planner.move(5, 5, 5, 6) == "\x1b[C");
+    REQUIRE(planner.move(5, 5, 5, 4) == "\b");
+    REQUIRE(planner.move(5, 5, 6, 5) == "\n");
+    REQUIRE(planner.move(5, 10, 6, 0) == "\r\n");
+    REQUIRE(planner.move(0, 0, 0, 16) == "\t\t");
+    REQUIRE(planner.move(5, 5, 20, 70) == "\x1b[21;71H");
+    REQUIRE(planner.cost(5, 5, 5, 70) == 5);
+    REQUIRE(planner.move(-1, -1, 0, 0) == "\x1b[H");
+    REQUIRE(planner.cost(5, 5, 20, 70) == 8);
+    REQUIRE(planner.cost(0, 0, -1, 3) == -1);
+
+    // never worse than cursor_address
+    for (long r = 0; r < 24; r += 5) {
+        for (long c = 0; c < 80; c += 7) {
+            for (long r1 = 0; r1 < 24; r1 += 3) {
+                for (long c1 = 0; c1 < 80; c1 += 11) {
+                    const auto s = planner.move(r, c, r1, c1);
+                    REQUIRE(static_cast<long>(s.size())
+                            == planner.cost(r, c, r1, c1));
+                    REQUIRE(s.size()
+                            <= parser.get(str::cursor_address, r1, c1).size());
+                }
+            }
+        }
+    }
+
+    // adm3a has no parameterized moves besides cursor_address
+    TermDb adm3a("adm3a", "terminfo/");
+    CursorPlanner dumb(adm3a);
+    REQUIRE(dumb.move(0, 0, 2, 0) == "\n\n");
+    REQUIRE(dumb.move(0, 0, 2, 10) == "\x1b=\"*");
+}
+
+TEST_CASE("Padding")
+{
+    TermDb adm3a("adm3a", "terminfo/");
+    REQUIRE(adm3a.delay(str::clear_screen, Speed(9600)) == 1000);
+    REQUIRE(adm3a.delay(str::cursor_home, Speed(9600)) == 0);
+
+    std::string out;
+    REQUIRE(adm3a.appendPadded(str::clear_screen, out, Speed(9600)) == 0);
+    REQUIRE(out == std::string("\x1a\0", 2));
+    out.clear();
+    REQUIRE(adm3a.appendPadded(str::clear_screen, out, Speed(115200)) == 0);
+    REQUIRE(out == "\x1a" + std::string(12, '\0'));
+
+    // xterm has no pad character, the delay is left to the caller
+    TermDb xterm("xterm", "terminfo/");
+    out.clear();
+    REQUIRE(xterm.appendPadded(str::flash_screen, out, Speed(38400))
+            == 100000);
+    REQUIRE(out == "\x1b[?5h\x1b[?5l");
+    out.clear();
+    REQUIRE(xterm.appendPadded(str::cursor_address, out, Speed(38400), 4, 7)
+            == 0);
+    REQUIRE(out == "\x1b[5;8H");
+}
+
+// every string capability of 'a' and 'b' renders the same, with
+// parameters where it takes them
+static void sameStrings(const TermDb &a, const TermDb &b)
+{
+    for (int i = 0; i < numCapStr; ++i) {
+        REQUIRE(a.get(static_cast<str>(i), 3, 4)
+                == b.get(static_cast<str>(i), 3, 4));
+    }
+}
+
+TEST_CASE("Image")
+{
+    REQUIRE(Image::write("terminfo/", "test.img") == ParseError::Success);
+    REQUIRE(Image::write("missing/", "test.img") == ParseError::ReadError);
+    REQUIRE(Image::write("terminfo/", "terminfo/test.img")
+            == ParseError::Success);
+    std::remove("terminfo/test.img");
+
+    Image image;
+    REQUIRE(image.open("terminfo/x/xterm") == ParseError::MagicByteError);
+    REQUIRE(image.open("test.img") == ParseError::Success);
+    // the corrupted databases are left out
+    REQUIRE(image.size() == 4);
+    REQUIRE(image.contains("xterm"));
+    REQUIRE(image.contains("lsi adm3a") == false);
+    REQUIRE_FALSE(image.contains("corrupted"));
+
+    std::error_code ec;
+    REQUIRE_FALSE(image.load("vt100", ec));
+    REQUIRE(ec == ParseError::ReadError);
+
+    TermDb packed(image.load("xterm-256color"));
+    TermDb loose("xterm-256color", "terminfo/");
+    image = Image();
+    REQUIRE(packed.getName() == loose.getName());
+    REQUIRE(packed.get(num::max_colors).value() == 256);
+    REQUIRE(packed.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+    REQUIRE(packed.getExtBool("AX") == loose.getExtBool("AX"));
+    sameStrings(packed, loose);
+
+    // a name in both layouts is taken from the letter directory, like
+    // loadDB() does, whatever order the directories are listed in
+    std::ifstream in("terminfo/a/adm3a", std::ios::binary);
+    const std::string adm3a((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    std::ifstream xterm("terminfo/x/xterm", std::ios::binary);
+    const std::string xtermBytes((std::istreambuf_iterator<char>(xterm)),
+                                 std::istreambuf_iterator<char>());
+    const std::string letters = "abcdefgh";
+    ::mkdir("layouts", 0755);
+    for (const auto c : letters) {
+        const auto letter = std::string("layouts/") + c;
+        const auto hex    = "layouts/" + std::to_string(60 + c - 'a' + 1);
+        ::mkdir(letter.c_str(), 0755);
+        ::mkdir(hex.c_str(), 0755);
+        std::ofstream(hex + '/' + c + "term", std::ios::binary) << adm3a;
+        std::ofstream(letter + '/' + c + "term", std::ios::binary)
+          << xtermBytes;
+    }
+    REQUIRE(Image::write("layouts", "test.img") == ParseError::Success);
+    REQUIRE(image.open("test.img") == ParseError::Success);
+    for (const auto c : letters) {
+        REQUIRE(TermDb(image.load(std::string(1, c) + "term")).getName()
+                == TermDb("xterm", "terminfo/").getName());
+    }
+    for (const auto c : letters) {
+        const auto letter = std::string("layouts/") + c;
+        const auto hex    = "layouts/" + std::to_string(60 + c - 'a' + 1);
+        std::remove((hex + '/' + c + "term").c_str());
+        std::remove((letter + '/' + c + "term").c_str());
+        ::rmdir(letter.c_str());
+        ::rmdir(hex.c_str());
+    }
+    ::rmdir("layouts");
+}
+
+TEST_CASE("Bulk loading")
+{
+    const std::vector<std::string> names{ "xterm", "aaaa", "adm3a",
+                                          "corrupted", "xterm-direct" };
+    const auto results = loadAll(names, "terminfo/", 3);
+    REQUIRE(results.size() == names.size());
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        REQUIRE(results[i].name == names[i]);
+        REQUIRE(bool(results[i].entry) == !results[i].error);
+    }
+    REQUIRE(results[1].error == ParseError::ReadError);
+    REQUIRE(results[3].error == ParseError::BadDatabase);
+    REQUIRE(TermDb(results[2].entry).get(bin::auto_right_margin));
+
+    const auto everything = loadAll("terminfo", 2);
+    REQUIRE(everything.size() == 7);
+    REQUIRE(everything.front().name == "adm3a");
+    std::size_t loaded = 0;
+    for (const auto &r : everything) {
+        loaded += r.entry != nullptr;
+    }
+    REQUIRE(loaded == 4);
+}
+
+TEST_CASE("Directory index")
+{
+    std::ifstream in("terminfo/a/adm3a", std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    REQUIRE(bytes.compare(12, 15, "adm3a|lsi adm3a") == 0);
+    ::mkdir("index", 0755);
+    ::mkdir("index/a", 0755);
+    ::mkdir("index/z", 0755);
+    std::ofstream("index/a/adm3a", std::ios::binary) << bytes;
+
+    DirectoryIndex index("index");
+    REQUIRE(index.path() == "index/");
+    REQUIRE(index.size() == 1);
+    REQUIRE(index.find("adm3a").value() == "index/a/adm3a");
+    REQUIRE_FALSE(index.find("adm3b"));
+    REQUIRE_FALSE(index.refresh());
+
+    // another file whose names section brings an alias
+    bytes.replace(12, 5, "adm3b");
+    std::ofstream("index/z/zz", std::ios::binary) << bytes;
+    REQUIRE(index.refresh());
+    REQUIRE(index.size() == 3);
+    REQUIRE(index.find("adm3b").value() == "index/z/zz");
+    const std::vector<std::string> both{ "adm3a", "adm3b" };
+    REQUIRE(index.withPrefix("adm3") == both);
+    REQUIRE(index.withPrefix("vt").empty());
+
+    std::error_code ec;
+    TermDb aliased(index.load("adm3b", ec));
+    REQUIRE_FALSE(ec);
+    REQUIRE(aliased.getName() == "adm3b|lsi adm3a");
+
+    // rewritten in place, the directory keeps its time but the file not
+    bytes.replace(12, 5, "adm3c");
+    std::ofstream("index/z/zz", std::ios::binary) << bytes;
+    const struct timespec past[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    REQUIRE(::utimensat(AT_FDCWD, "index/z/zz", past, 0) == 0);
+    REQUIRE(index.refresh());
+    REQUIRE(index.find("adm3c").value() == "index/z/zz");
+    REQUIRE_FALSE(index.contains("adm3b"));
+    REQUIRE_FALSE(index.refresh());
+    REQUIRE_FALSE(index.load("vt100", ec));
+    REQUIRE(ec == ParseError::ReadError);
+
+    std::remove("index/a/adm3a");
+    std::remove("index/z/zz");
+    ::rmdir("index/a");
+    ::rmdir("index/z");
+    ::rmdir("index");
+    REQUIRE(index.refresh());
+    REQUIRE(index.size() == 0);
+}
+
+TEST_CASE("Search path")
+{
+    const std::string home = std::getenv("HOME") ? std::getenv("HOME") : "";
+    ::setenv("TERMINFO", "first", 1);
+    ::setenv("HOME", "/home/user", 1);
+    ::setenv("TERMINFO_DIRS", "second::third/", 1);
+    const std::vector<std::string> expected{
+        "first/",          "/home/user/.terminfo/", "second/", DPATH,
+        "third/",          "/etc/terminfo/",        "/lib/terminfo/"
+    };
+    const auto found = SearchPath().directories();
+    ::unsetenv("TERMINFO");
+    ::unsetenv("TERMINFO_DIRS");
+    ::setenv("HOME", home.c_str(), 1);
+    REQUIRE(found == expected);
+
+    SearchPath search({ "missing", "search/", "terminfo/", "search" },
+                      std::chrono::milliseconds(0));
+    REQUIRE(search.directories().size() == 3);
+    REQUIRE(search.resolve("xterm").value() == "terminfo/x/xterm");
+    REQUIRE_FALSE(search.resolve("vt100"));
+    REQUIRE_FALSE(search.resolve("../x/xterm"));
+
+    // misses and hits both notice new files
+    ::mkdir("search", 0755);
+    REQUIRE_FALSE(search.resolve("vt100"));
+    ::mkdir("search/76", 0755);
+    ::mkdir("search/x", 0755);
+    std::ofstream("search/76/vt100") << "vt100";
+    std::ofstream("search/x/xterm") << "xterm";
+    REQUIRE(search.resolve("vt100").value() == "search/76/vt100");
+    REQUIRE(search.resolve("xterm").value() == "search/x/xterm");
+
+    std::error_code ec;
+    REQUIRE_FALSE(search.load("xterm", ec));
+    REQUIRE(ec == ParseError::BadDatabase);
+    std::remove("search/x/xterm");
+    REQUIRE(search.load("xterm", ec));
+    REQUIRE_FALSE(search.load("vt220", ec));
+    REQUIRE(ec == ParseError::ReadError);
+
+    std::remove("search/76/vt100");
+    ::rmdir("search/76");
+    ::rmdir("search/x");
+    ::rmdir("search");
+    REQUIRE_FALSE(search.resolve("vt100"));
+}
+
+TEST_CASE("Asynchronous loading")
+{
+    auto xterm   = loadAsync("xterm", "terminfo/");
+    auto missing = loadAsync("aaaa", "terminfo/");
+    const auto loaded = xterm.get();
+    REQUIRE_FALSE(loaded.error);
+    REQUIRE(loaded.name == "xterm");
+    // prefetched into the registry
+    REQUIRE(loaded.entry == Registry::global().load("xterm", "terminfo/"));
+    REQUIRE(missing.get().error == ParseError::ReadError);
+
+    // a caller supplied executor, here running tasks later on this thread
+    std::vector<std::function<void()>> queued;
+    const auto executor = [&queued](std::function<void()> task) {
+        queued.push_back(std::move(task));
+    };
+    LoadResult result;
+    loadAsync(executor, "adm3a", "terminfo/",
+              [&result](LoadResult r) { result = std::move(r); });
+    REQUIRE(queued.size() == 1);
+    REQUIRE_FALSE(result.entry);
+    queued.front()();
+    REQUIRE(TermDb(result.entry).get(bin::auto_right_margin));
+}
+
+TEST_CASE("Parsing from memory")
+{
+    std::ifstream in("terminfo/x/xterm", std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    TermDb file("xterm", "terminfo/");
+
+    TermDb copied;
+    REQUIRE(copied.parseFromMemory(bytes.data(), bytes.size()));
+    TermDb borrowed;
+    REQUIRE(borrowed.parseFromMemory(bytes.data(), bytes.size(),
+                                     Memory::Borrow));
+    REQUIRE(borrowed.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+    // the copy doesn't depend on the buffer any more
+    const auto original = bytes;
+    std::fill(bytes.begin(), bytes.end(), '\0');
+    REQUIRE(copied.getName() == file.getName());
+    REQUIRE(copied.get(str::cursor_address, 4, 7) == "\x1b[5;8H");
+    REQUIRE(copied.getExtBool("AX") == file.getExtBool("AX"));
+    bytes = original;
+
+    std::error_code ec;
+    REQUIRE_FALSE(loadFromMemory(nullptr, 0, ec));
+    REQUIRE(ec == ParseError::BadDatabase);
+    REQUIRE_FALSE(loadFromMemory(bytes.data(), 100, ec));
+    REQUIRE(ec == ParseError::BadDatabase);
+    const char swapped[12] = { 0x01, 0x1a };
+    REQUIRE_FALSE(
+      loadFromMemory(swapped, sizeof(swapped), ec, Memory::Borrow));
+    REQUIRE(ec == ParseError::MagicByteError);
+    REQUIRE_FALSE(copied.parseFromMemory(bytes.data(), 11));
+    REQUIRE_FALSE(copied);
+
+    // every truncation is either rejected or parses
+    for (std::size_t size = 0; size <= bytes.size(); size += 7) {
+        loadFromMemory(bytes.data(), size, ec, Memory::Borrow);
+    }
+
+    // the string table ends on the last byte after an odd names and
+    // booleans section, a heap block of exactly that size must do
+    const uint8_t odd[] = { 0x1a, 0x01, 2, 0, 1, 0, 0, 0, 1, 0, 2, 0,
+                            'x',  0,    1, 0, 0, 0, 'A', 0 };
+    for (auto size = sizeof(odd) - 1; size <= sizeof(odd); ++size) {
+        std::unique_ptr<uint8_t[]> exact(new uint8_t[size]);
+        std::copy(odd, odd + size, exact.get());
+        for (const auto mode : { Memory::Copy, Memory::Borrow }) {
+            const auto entry = loadFromMemory(exact.get(), size, ec, mode);
+            REQUIRE(bool(entry) == (size == sizeof(odd)));
+            if (entry) {
+                REQUIRE(TermDb(entry).get(str::back_tab) == "A");
+            }
+        }
+    }
+}
+
+TEST_CASE("Embedded terminals")
+{
+    // the tables embedTerms writes out, here views of loaded entries
+    TermDb adm3a("adm3a", "terminfo/");
+    TermDb xterm("xterm", "terminfo/");
+    const auto adm3aTables = Registry::global().load("adm3a", "terminfo/");
+    const auto xtermTables = Registry::global().load("xterm", "terminfo/");
+    REQUIRE(adm3aTables);
+    REQUIRE(xtermTables);
+    const auto compiledAdm3a = adm3aTables->compiled();
+    const auto compiledXterm = xtermTables->compiled();
+    const Embedded table[] = { { "adm3a", 0, &compiledAdm3a },
+                               { "lsi", 0, &compiledAdm3a },
+                               { "xterm", 2, &compiledXterm } };
+
+    // neither building the set nor loading from it allocates
+    const auto before = allocations.load();
+    const EmbeddedSet<3> set(table);
+    std::error_code ec;
+    const auto entry = set.load("adm3a", ec);
+    const auto alias = set.load("lsi");
+    TermDb embedded(set.load("xterm", ec));
+    REQUIRE(allocations == before);
+
+    REQUIRE(set.size() == 3);
+    REQUIRE(set.contains("lsi"));
+    REQUIRE_FALSE(set.contains("adm3"));
+    REQUIRE_FALSE(ec);
+    // aliases share the entry
+    REQUIRE(alias == entry);
+    REQUIRE(TermDb(entry).getName() == adm3a.getName());
+    REQUIRE(TermDb(entry).get(bin::auto_right_margin));
+
+    REQUIRE(embedded.getName() == xterm.getName());
+    for (int b = 0; b < numCapBool; ++b) {
+        REQUIRE(embedded.get(static_cast<bin>(b))
+                == xterm.get(static_cast<bin>(b)));
+    }
+    for (int n = 0; n < numCapNum; ++n) {
+        REQUIRE(embedded.get(static_cast<num>(n))
+                == xterm.get(static_cast<num>(n)));
+    }
+    sameStrings(embedded, xterm);
+    REQUIRE(embedded.getExtBool("AX") == xterm.getExtBool("AX"));
+    REQUIRE(embedded.getExtStr("Ms", 1, "x") == xterm.getExtStr("Ms", 1, "x"));
+
+    REQUIRE_FALSE(set.load("vt100", ec));
+    REQUIRE(ec == ParseError::ReadError);
+}
+
+TEST_CASE("Memory footprint")
+{
+    std::ifstream in("terminfo/x/xterm", std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    TermDb file("xterm", "terminfo/");
+    TermDb packed;
+    REQUIRE(packed.parseFromMemory(bytes.data(), bytes.size(),
+                                   Memory::Borrow));
+    // nothing refers to the input once it is loaded
+    std::fill(bytes.begin(), bytes.end(), '\0');
+    REQUIRE(packed.getName() == file.getName());
+    REQUIRE(packed.getExtBool("AX") == file.getExtBool("AX"));
+    REQUIRE(packed.getExtStr("Ms", 1, "x") == file.getExtStr("Ms", 1, "x"));
+    sameStrings(packed, file);
+
+    REQUIRE(TermDb().memoryFootprint() == sizeof(TermDb));
+    REQUIRE(packed.memoryFootprint() == file.memoryFootprint());
+    REQUIRE(packed.memoryFootprint() > sizeof(TermDb));
+    REQUIRE(packed.memoryFootprint() < sizeof(TermDb) + 32 * 1024);
+}
+
+TEST_CASE("Pooled loading")
+{
+    const std::vector<std::string> names{ "xterm", "xterm-256color", "aaaa",
+                                          "xterm-direct", "adm3a" };
+    PoolStats stats;
+    const auto results = loadPooled(names, "terminfo/", 2, &stats);
+    REQUIRE(results.size() == names.size());
+    REQUIRE(results[2].error == ParseError::ReadError);
+    // the xterm variants have most of their strings in common
+    REQUIRE(stats.programs > 0);
+    REQUIRE(stats.pooled * 2 < stats.bytes);
+
+    for (const auto &r : results) {
+        if (r.error) {
+            continue;
+        }
+        TermDb pooled(r.entry);
+        TermDb alone(r.name, "terminfo/");
+        REQUIRE(pooled.getName() == alone.getName());
+        REQUIRE(pooled.memoryFootprint() < alone.memoryFootprint());
+        REQUIRE(pooled.getExtStr("Ms", 1, "x")
+                == alone.getExtStr("Ms", 1, "x"));
+        sameStrings(pooled, alone);
+    }
+}
+
+TEST_CASE("Lazy decoding")
+{
+    const std::vector<std::string> names{ "xterm", "xterm-direct", "aaaa",
+                                          "adm3a" };
+    const auto lazy  = loadAll(names, "terminfo/", 2, Decode::Lazy);
+    const auto eager = loadAll(names, "terminfo/", 2);
+    REQUIRE(lazy.size() == names.size());
+    REQUIRE(lazy[2].error == ParseError::ReadError);
+
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (lazy[i].error) {
+            continue;
+        }
+        REQUIRE(!lazy[i].entry->isDecoded());
+        REQUIRE(eager[i].entry->isDecoded());
+        TermDb later(lazy[i].entry);
+        TermDb now(eager[i].entry);
+
+        // booleans and numbers don't need the strings
+        for (int b = 0; b < numCapBool; ++b) {
+            REQUIRE(later.get(static_cast<bin>(b))
+                    == now.get(static_cast<bin>(b)));
+        }
+        REQUIRE(later.get(num::columns) == now.get(num::columns));
+        // nor does the name
+        REQUIRE(later.getName() == now.getName());
+        REQUIRE(!lazy[i].entry->isDecoded());
+
+        // the first string decodes the entry for every thread at once,
+        // names read meanwhile stay the same
+        std::vector<std::string> seen(4);
+        std::vector<std::thread> threads;
+        for (auto &s : seen) {
+            threads.emplace_back([&later, &s]() {
+                s = later.getName() + later.get(str::cursor_address, 3, 4);
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        REQUIRE(lazy[i].entry->isDecoded());
+        for (const auto &s : seen) {
+            REQUIRE(s == now.getName() + now.get(str::cursor_address, 3, 4));
+        }
+
+        REQUIRE(later.getName() == now.getName());
+        REQUIRE(later.memoryFootprint() == now.memoryFootprint());
+        REQUIRE(later.getExtStr("Ms", 1, "x") == now.getExtStr("Ms", 1, "x"));
+        sameStrings(later, now);
+    }
+
+    // extended capabilities decode too
+    const auto direct = loadAll({ "xterm-direct" }, "terminfo/", 1,
+                                Decode::Lazy);
+    REQUIRE(direct[0].entry);
+    REQUIRE(TermDb(direct[0].entry).getExtBool("RGB"));
+}
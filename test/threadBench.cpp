@@ -0,0 +1,96 @@
+#include "termdb.hpp"
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace tdb;
+using namespace std;
+
+// every thread sweeps all string capabilities of all terminals through
+// the same const TermDb objects
+unsigned long sweep(const vector<TermDb> &parsers, const int rounds)
+{
+    unsigned long bytes = 0;
+    char buf[4096];
+    for (auto r = 0; r < rounds; ++r) {
+        for (auto &parser : parsers) {
+            for (auto i = 0; i < tdb::numCapStr; ++i) {
+                bytes += parser.getInto(static_cast<str>(i), buf, sizeof(buf),
+                                        r % 80, i % 24, 1, 1, 1, 1, 1, 1, 1);
+            }
+        }
+    }
+    return bytes;
+}
+
+int main()
+{
+    ifstream names("stressTestTerms.txt");
+    if (!names) {
+        return -1;
+    }
+
+    vector<TermDb> parsers;
+    parsers.reserve(2718);
+
+    string name;
+    while (getline(names, name)) {
+        TermDb parser;
+        if (parser.parse(name, "mirror/")) {
+            parsers.emplace_back(std::move(parser));
+        }
+    }
+
+    constexpr auto rounds = 4;
+    const auto maxThreads = max(1u, thread::hardware_concurrency());
+    const auto calls      = double(parsers.size()) * tdb::numCapStr * rounds;
+
+    double single = 0;
+    atomic<unsigned long> total{ 0 };
+    for (auto n = 1u;; n = min(n * 2, maxThreads)) {
+        vector<thread> workers;
+
+        const auto start = chrono::steady_clock::now();
+        for (auto t = 0u; t < n; ++t) {
+            workers.emplace_back([&]() { total += sweep(parsers, rounds); });
+        }
+        for (auto &w : workers) {
+            w.join();
+        }
+        const chrono::duration<double> elapsed
+          = chrono::steady_clock::now() - start;
+
+        const auto throughput = calls * n / elapsed.count();
+        if (n == 1) {
+            single = throughput;
+        }
+        cout << n << " threads: " << static_cast<long>(throughput)
+             << " calls/s, speedup " << throughput / single << "\n";
+
+        if (n == maxThreads) {
+            break;
+        }
+    }
+    cout << total << " bytes written\n";
+
+    // loading the whole mirror/ directory with loadAll()
+    double serial = 0;
+    for (auto n = 1u;; n = min(n * 2, maxThreads)) {
+        const auto start  = chrono::steady_clock::now();
+        const auto loaded = loadAll("mirror", n);
+        const chrono::duration<double> elapsed
+          = chrono::steady_clock::now() - start;
+
+        if (n == 1) {
+            serial = elapsed.count();
+        }
+        cout << n << " threads: loaded " << loaded.size() << " terminals in "
+             << elapsed.count() * 1000 << " ms, speedup "
+             << serial / elapsed.count() << "\n";
+
+        if (n == maxThreads) {
+            break;
+        }
+    }
+}
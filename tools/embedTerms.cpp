@@ -0,0 +1,243 @@
+#include "termdb.hpp"
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+/*
+    Writes a header declaring embeddedTerms::terminals() and the one source
+    file defining it, with the named terminals compiled into constexpr
+    tables: their names, booleans, numbers and the programs and text of
+    their string capabilities, see tdb::detail::Compiled. Loading from the
+    set parses and allocates nothing, see tdb::EmbeddedSet. The source is
+    compiled into the program once, so every translation unit including
+    the header shares the same set.
+
+    Text is written as string literals with every byte that isn't plain
+    printable ASCII, or is a quote, a backslash or a question mark, as
+    an octal escape, so any name or capability can be embedded.
+*/
+
+namespace {
+    using namespace tdb::detail;
+
+    // 's' as the body of a C string literal
+    std::string literal(const char *s, std::size_t n)
+    {
+        std::string out;
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto c = static_cast<unsigned char>(s[i]);
+            if (c >= ' ' && c < 0x7f && c != '"' && c != '\\' && c != '?') {
+                out += static_cast<char>(c);
+            } else {
+                const char octal[] = { '\\', char('0' + (c >> 6)),
+                                       char('0' + ((c >> 3) & 7)),
+                                       char('0' + (c & 7)), '\0' };
+                out += octal;
+            }
+        }
+        return out;
+    }
+
+    std::string baseName(const std::string &path)
+    {
+        const auto slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    std::ostream &operator<<(std::ostream &out, const Program &p)
+    {
+        return out << "{ " << p.begin << ", " << p.size << ", "
+                   << (p.valid ? "true" : "false") << ", " << unsigned(p.flags)
+                   << ", " << unsigned(p.arity) << ", " << p.strings << " }";
+    }
+
+    std::ostream &operator<<(std::ostream &out, const Padding &p)
+    {
+        return out << "{ " << p.delay << ", " << unsigned(p.flags) << " }";
+    }
+
+    std::ostream &operator<<(std::ostream &out, const Instr &in)
+    {
+        return out << "{ Op(" << unsigned(in.op) << "), " << unsigned(in.arg)
+                   << ", " << in.len << ", " << in.val << " }";
+    }
+
+    std::ostream &operator<<(std::ostream &out, const Extended::Cap &cap)
+    {
+        return out << "{ " << cap.name << ", " << cap.nameLength << ", Type("
+                   << unsigned(cap.type) << "), " << cap.value << " }";
+    }
+
+    /*
+        Writes 'v' as the constexpr array 'array' of 'type' and returns
+        the initializer of its view, arrays can't be empty so an empty
+        view has none.
+    */
+    template <typename T>
+    std::string table(std::ostream &out, const std::string &type,
+                      const std::string &array, View<T> v, std::size_t perLine)
+    {
+        if (v.empty()) {
+            return "{}";
+        }
+        out << "    constexpr " << type << ' ' << array << "[] = {";
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            out << (i % perLine ? " " : "\n        ") << v[i] << ',';
+        }
+        out << "\n    };\n";
+        return "{ " + array + ", " + std::to_string(v.size()) + " }";
+    }
+
+    std::string chars(std::ostream &out, const std::string &array,
+                      View<char> v)
+    {
+        if (v.empty()) {
+            return "{}";
+        }
+        out << "    constexpr char " << array << "[] = \""
+            << literal(v.data(), v.size()) << "\";\n";
+        return "{ " + array + ", " + std::to_string(v.size()) + " }";
+    }
+
+    // the tables of 'c' and the Compiled named 'entry' pointing at them
+    void writeEntry(std::ostream &out, const std::string &entry,
+                    const Compiled &c)
+    {
+        std::ostringstream booleans;
+        booleans << "0x" << std::hex << c.booleans << "ull";
+
+        const auto name     = chars(out, entry + "Name", c.name);
+        const auto numbers  = table(out, "int32_t", entry + "Numbers",
+                                   c.numbers, 10);
+        const auto slots    = table(out, "uint16_t", entry + "Slots", c.slots,
+                                 16);
+        const auto programs = table(out, "Program", entry + "Programs",
+                                    c.programs, 3);
+        const auto padding  = table(out, "Padding", entry + "Padding",
+                                   c.padding, 6);
+        const auto instrs   = table(out, "Instr", entry + "Instrs", c.instrs,
+                                  3);
+        const auto text     = chars(out, entry + "Chars", c.chars);
+        const auto extNames = chars(out, entry + "ExtNames", c.extNames);
+        const auto extCaps  = table(out, "Extended::Cap", entry + "ExtCaps",
+                                   c.extCaps, 3);
+        const auto extSlots = table(out, "uint16_t", entry + "ExtSlots",
+                                    c.extSlots, 16);
+        const auto extPrograms = table(out, "Program", entry + "ExtPrograms",
+                                       c.extPrograms, 3);
+        const auto extPadding  = table(out, "Padding", entry + "ExtPadding",
+                                      c.extPadding, 6);
+
+        out << "    constexpr Compiled " << entry << " = {\n"
+            << "        " << name << ",\n"
+            << "        " << booleans.str() << ",\n"
+            << "        " << numbers << ",\n"
+            << "        " << slots << ",\n"
+            << "        " << programs << ",\n"
+            << "        " << padding << ",\n"
+            << "        " << instrs << ",\n"
+            << "        " << text << ",\n"
+            << "        " << extNames << ",\n"
+            << "        " << extCaps << ",\n"
+            << "        " << extSlots << ",\n"
+            << "        " << extPrograms << ",\n"
+            << "        " << extPadding << "\n"
+            << "    };\n\n";
+    }
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        std::cerr << "usage: " << argv[0]
+                  << " <terminfo directory> <header> <source> <name>...\n";
+        return 2;
+    }
+
+    // names to the file they resolve to, aliases included
+    const tdb::DirectoryIndex index(argv[1]);
+    std::map<std::string, std::string> names;
+    std::map<std::string, tdb::Registry::Entry> files;
+    for (auto i = 4; i < argc; ++i) {
+        const auto path = index.find(argv[i]);
+        if (!path) {
+            std::cerr << argv[i] << ": not found in " << argv[1] << '\n';
+            return 1;
+        }
+        names[argv[i]] = *path;
+        if (files.count(*path)) {
+            continue;
+        }
+        std::ifstream in(path->c_str(), std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)),
+                          std::istreambuf_iterator<char>());
+        std::error_code ec;
+        files[*path] = tdb::loadFromMemory(bytes.data(), bytes.size(), ec);
+        if (ec) {
+            std::cerr << *path << ": " << ec.message() << '\n';
+            return 1;
+        }
+    }
+    const auto set = "tdb::EmbeddedSet<" + std::to_string(names.size()) + ">";
+
+    std::ofstream header(argv[2]);
+    header << "// generated by tools/embedTerms.cpp from " << argv[1]
+           << ", do not edit\n"
+           << "#ifndef TDB_EMBEDDED_TERMS_HPP\n"
+           << "#define TDB_EMBEDDED_TERMS_HPP\n\n"
+           << "#include \"termdb.hpp\"\n\n"
+           << "namespace embeddedTerms {\n"
+           << "    // defined in " << baseName(argv[3])
+           << ", which is linked in once\n"
+           << "    const " << set << " &terminals();\n"
+           << "}  // namespace embeddedTerms\n\n"
+           << "#endif\n";
+    if (!header) {
+        std::cerr << argv[2] << ": can't be written\n";
+        return 1;
+    }
+
+    std::ofstream out(argv[3]);
+    out << "// generated by tools/embedTerms.cpp from " << argv[1]
+        << ", do not edit\n"
+        << "#include \"" << baseName(argv[2]) << "\"\n\n"
+        << "namespace embeddedTerms {\n"
+        << "namespace {\n"
+        << "    using namespace tdb::detail;\n"
+        << "    using Type = Extended::Type;\n\n";
+
+    std::map<std::string, std::size_t> entries;
+    for (const auto &file : files) {
+        const auto n = entries.size();
+        entries.emplace(file.first, n);
+        out << "    // " << literal(file.first.data(), file.first.size())
+            << "\n";
+        writeEntry(out, "entry" + std::to_string(n), file.second->compiled());
+    }
+
+    // rows of aliases name the first row of their entry
+    std::map<std::size_t, std::size_t> firstRows;
+    std::size_t row = 0;
+    out << "    constexpr tdb::Embedded table[] = {\n";
+    for (const auto &name : names) {
+        const auto n     = entries[name.second];
+        const auto first = firstRows.emplace(n, row++).first->second;
+        out << "        { \"" << literal(name.first.data(), name.first.size())
+            << "\", " << first << ", &entry" << n << " },\n";
+    }
+    out << "    };\n"
+        << "}  // namespace\n\n"
+        << "const " << set << " &terminals()\n"
+        << "{\n"
+        << "    static const " << set << " set(table);\n"
+        << "    return set;\n"
+        << "}\n"
+        << "}  // namespace embeddedTerms\n";
+    if (!out) {
+        std::cerr << argv[3] << ": can't be written\n";
+        return 1;
+    }
+    std::cout << names.size() << " names, " << files.size()
+              << " entries embedded into " << argv[3] << '\n';
+}
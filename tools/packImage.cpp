@@ -0,0 +1,23 @@
+#include "termdb.hpp"
+#include <iostream>
+
+// packs a terminfo directory into one image file, see tdb::Image
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <terminfo directory> <image>\n";
+        return 2;
+    }
+
+    const auto ec = tdb::Image::write(argv[1], argv[2]);
+    if (ec) {
+        std::cerr << argv[1] << ": " << ec.message() << '\n';
+        return 1;
+    }
+
+    tdb::Image image;
+    if (!image.open(argv[2])) {
+        std::cout << image.size() << " entries packed into " << argv[2]
+                  << '\n';
+    }
+}